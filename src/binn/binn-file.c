@@ -49,6 +49,12 @@ static bool write_list(binn* parent, object_t* object) {
             case type_int:     if (!binn_list_add_int64(parent, value->i))             return false;  break;
             case type_uint:    if (!binn_list_add_uint64(parent, value->u))            return false;  break;
             case type_str:     if (!binn_list_add_str(parent, CONST_CAST(value->str))) return false;  break;
+            case type_float:   if (!binn_list_add_float(parent, value->f))             return false;  break;
+
+            case type_bin:
+                if (!binn_list_add_blob(parent, CONST_CAST(value->str), (int)value->l))
+                    return false;
+                break;
 
             case type_array: {
                 binn child;
@@ -90,6 +96,12 @@ static bool write_object(binn* parent, object_t* object) {
             case type_int:     if (!binn_object_set_int64(parent, key, value->i))             return false;  break;
             case type_uint:    if (!binn_object_set_uint64(parent, key, value->u))            return false;  break;
             case type_str:     if (!binn_object_set_str(parent, key, CONST_CAST(value->str))) return false;  break;
+            case type_float:   if (!binn_object_set_float(parent, key, value->f))             return false;  break;
+
+            case type_bin:
+                if (!binn_object_set_blob(parent, key, CONST_CAST(value->str), (int)value->l))
+                    return false;
+                break;
 
             case type_array: {
                 binn child;
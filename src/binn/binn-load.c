@@ -40,6 +40,8 @@ static bool hash_value(binn* value, uint32_t* hash) {
         case BINN_NULL: *hash = hash_nil(*hash); return true;
         case BINN_BOOL: *hash = hash_bool(*hash, value->vbool); return true;
         case BINN_DOUBLE: *hash = hash_double(*hash, value->vdouble); return true;
+        case BINN_FLOAT: *hash = hash_float(*hash, value->vfloat); return true;
+        case BINN_BLOB: *hash = hash_bin(*hash, (const char*)value->ptr, value->size); return true;
         case BINN_STRING: {
             // for strings, "size" appears to be zero. we have to scan for the
             // null-terminator. technically we could add a hash function for cstr
@@ -121,7 +123,8 @@ static bool hash_object(binn* parent, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
@@ -151,7 +154,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -51,6 +51,12 @@ static bool write_list(binn* parent, object_t* object) {
             case type_int:     if (!binn_list_add_int64(parent, value->i))             return false;  break;
             case type_uint:    if (!binn_list_add_uint64(parent, value->u))            return false;  break;
             case type_str:     if (!binn_list_add_str(parent, CONST_CAST(value->str))) return false;  break;
+            case type_float:   if (!binn_list_add_float(parent, value->f))             return false;  break;
+
+            case type_bin:
+                if (!binn_list_add_blob(parent, CONST_CAST(value->str), (int)value->l))
+                    return false;
+                break;
 
             case type_array: {
                 binn child;
@@ -92,6 +98,12 @@ static bool write_object(binn* parent, object_t* object) {
             case type_int:     if (!binn_object_set_int64(parent, key, value->i))             return false;  break;
             case type_uint:    if (!binn_object_set_uint64(parent, key, value->u))            return false;  break;
             case type_str:     if (!binn_object_set_str(parent, key, CONST_CAST(value->str))) return false;  break;
+            case type_float:   if (!binn_object_set_float(parent, key, value->f))             return false;  break;
+
+            case type_bin:
+                if (!binn_object_set_blob(parent, key, CONST_CAST(value->str), (int)value->l))
+                    return false;
+                break;
 
             case type_array: {
                 binn child;
@@ -123,14 +135,15 @@ static bool write_object(binn* parent, object_t* object) {
 }
 
 bool run_test(uint32_t* hash_out) {
+    object_t* object = benchmark_object(root_object);
     binn root;
     bool ok;
-    if (root_object->type == type_map) {
+    if (object->type == type_map) {
         binn_create_object(&root);
-        ok = write_object(&root, root_object);
+        ok = write_object(&root, object);
     } else {
         binn_create_list(&root);
-        ok = write_list(&root, root_object);
+        ok = write_list(&root, object);
     }
 
     if (!ok) {
@@ -139,6 +152,7 @@ bool run_test(uint32_t* hash_out) {
         return false;
     }
 
+    benchmark_output_size(binn_size(&root));
     *hash_out = hash_str(*hash_out, binn_ptr(&root), binn_size(&root));
 
     // like libbson, we call binn_free() regardless of whether
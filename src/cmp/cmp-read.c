@@ -63,6 +63,7 @@ static bool hash_element(cmp_ctx_t* cmp, uint32_t* hash) {
         case CMP_TYPE_NIL: *hash = hash_nil(*hash); return true;
         case CMP_TYPE_BOOLEAN: *hash = hash_bool(*hash, object.as.boolean); return true;
         case CMP_TYPE_DOUBLE: *hash = hash_double(*hash, object.as.dbl); return true;
+        case CMP_TYPE_FLOAT: *hash = hash_float(*hash, object.as.flt); return true;
 
         // note: all ints are hashed as 64-bit (not all libraries read different sized types)
 
@@ -92,6 +93,37 @@ static bool hash_element(cmp_ctx_t* cmp, uint32_t* hash) {
             return true;
         }
 
+        case CMP_TYPE_BIN8:
+        case CMP_TYPE_BIN16:
+        case CMP_TYPE_BIN32:
+        {
+            uint32_t len = object.as.bin_size;
+            if (buffer->left < len)
+                return false;
+            *hash = hash_bin(*hash, buffer->data, len);
+            buffer->data += len;
+            buffer->left -= len;
+            return true;
+        }
+
+        case CMP_TYPE_FIXEXT1:
+        case CMP_TYPE_FIXEXT2:
+        case CMP_TYPE_FIXEXT4:
+        case CMP_TYPE_FIXEXT8:
+        case CMP_TYPE_FIXEXT16:
+        case CMP_TYPE_EXT8:
+        case CMP_TYPE_EXT16:
+        case CMP_TYPE_EXT32:
+        {
+            uint32_t len = object.as.ext.size;
+            if (buffer->left < len)
+                return false;
+            *hash = hash_ext(*hash, object.as.ext.type, buffer->data, len);
+            buffer->data += len;
+            buffer->left -= len;
+            return true;
+        }
+
         case CMP_TYPE_FIXARRAY:
         case CMP_TYPE_ARRAY16:
         case CMP_TYPE_ARRAY32:
@@ -130,13 +162,14 @@ static bool hash_element(cmp_ctx_t* cmp, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
     buffer_t buffer;
     buffer.data = data;
-    buffer.left = file_size;
+    buffer.left = size;
 
     cmp_ctx_t cmp;
     cmp_init(&cmp, &buffer, buffer_cmp_reader, NULL);
@@ -154,7 +187,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
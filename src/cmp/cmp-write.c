@@ -38,6 +38,11 @@ static bool write_object(cmp_ctx_t* cmp, object_t* object) {
         case type_uint:   return cmp_write_uint(cmp, object->u);
         case type_double: return cmp_write_double(cmp, object->d);
         case type_str:    return cmp_write_str(cmp, object->str, object->l);
+        case type_float:  return cmp_write_float(cmp, object->f);
+        case type_bin:    return cmp_write_bin(cmp, object->str, object->l);
+
+        case type_ext:
+            return cmp_write_ext(cmp, object_ext_type(object), object->l, object_ext_data(object));
 
         case type_array:
             if (!cmp_write_array(cmp, object->l))
@@ -72,15 +77,17 @@ static bool write_object(cmp_ctx_t* cmp, object_t* object) {
 
 bool run_test(uint32_t* hash_out) {
     buffer_t buffer;
-    buffer_init(&buffer);
+    if (!buffer_init(&buffer))
+        return false;
     cmp_ctx_t cmp;
     cmp_init(&cmp, &buffer, NULL, buffer_cmp_writer);
 
-    if (!write_object(&cmp, root_object)) {
+    if (!write_object(&cmp, benchmark_object(root_object))) {
         buffer_destroy(&buffer);
         return false;
     }
 
+    benchmark_output_size(buffer.count);
     *hash_out = hash_str(*hash_out, buffer.data, buffer.count);
     buffer_destroy(&buffer);
     return true;
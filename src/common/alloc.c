@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// we need RTLD_NEXT, dladdr() and malloc_usable_size()
+#define _GNU_SOURCE 1
+
+#include "alloc.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+
+typedef void* (*malloc_fn)(size_t);
+typedef void* (*calloc_fn)(size_t, size_t);
+typedef void* (*realloc_fn)(void*, size_t);
+typedef void (*free_fn)(void*);
+typedef int (*posix_memalign_fn)(void**, size_t, size_t);
+typedef void* (*aligned_alloc_fn)(size_t, size_t);
+typedef void* (*valloc_fn)(size_t);
+typedef size_t (*usable_size_fn)(void*);
+
+static malloc_fn real_malloc;
+static calloc_fn real_calloc;
+static realloc_fn real_realloc;
+static free_fn real_free;
+static posix_memalign_fn real_posix_memalign;
+static aligned_alloc_fn real_aligned_alloc;
+static aligned_alloc_fn real_memalign;
+static valloc_fn real_valloc;
+static valloc_fn real_pvalloc;
+static usable_size_fn real_usable_size;
+
+static bool tracking;
+static alloc_stats_t stats;
+
+// The blocks allocated while tracking, with the sizes we counted for them.
+// Blocks that were allocated before tracking started (by the test's setup,
+// or on a previous iteration) aren't in it, so freeing them doesn't take
+// anything off the live bytes. It's an open addressing hash table with
+// linear probing, allocated with the real allocator and cleared when
+// tracking starts. Tracking is only on outside the timed loop so a lock
+// around it is fine.
+typedef struct block_t {
+    void* ptr;
+    int64_t size;
+} block_t;
+
+static block_t* blocks;
+static size_t block_capacity; // a power of two
+static size_t block_count;
+static bool block_lock;
+
+static void lock_blocks(void) {
+    while (__atomic_test_and_set(&block_lock, __ATOMIC_ACQUIRE))
+        ;
+}
+
+static void unlock_blocks(void) {
+    __atomic_clear(&block_lock, __ATOMIC_RELEASE);
+}
+
+static size_t block_slot(void* ptr) {
+    uint64_t hash = (uint64_t)(uintptr_t)ptr * UINT64_C(0x9E3779B97F4A7C15);
+    return (size_t)(hash >> 32) & (block_capacity - 1);
+}
+
+static bool blocks_grow(void) {
+    size_t old_capacity = block_capacity;
+    block_t* old_blocks = blocks;
+    size_t capacity = old_capacity ? old_capacity * 2 : 1024;
+    block_t* new_blocks = (block_t*)real_calloc(capacity, sizeof(block_t));
+    if (!new_blocks)
+        return false;
+    blocks = new_blocks;
+    block_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (!old_blocks[i].ptr)
+            continue;
+        size_t slot = block_slot(old_blocks[i].ptr);
+        while (blocks[slot].ptr)
+            slot = (slot + 1) & (block_capacity - 1);
+        blocks[slot] = old_blocks[i];
+    }
+    real_free(old_blocks);
+    return true;
+}
+
+static bool blocks_insert(void* ptr, int64_t size) {
+    if ((block_count + 1) * 2 > block_capacity && !blocks_grow())
+        return false;
+    size_t slot = block_slot(ptr);
+    while (blocks[slot].ptr && blocks[slot].ptr != ptr)
+        slot = (slot + 1) & (block_capacity - 1);
+    if (!blocks[slot].ptr)
+        ++block_count;
+    blocks[slot].ptr = ptr;
+    blocks[slot].size = size;
+    return true;
+}
+
+// Removes the block and returns its size, or -1 if it isn't tracked.
+static int64_t blocks_remove(void* ptr) {
+    if (block_count == 0)
+        return -1;
+    size_t mask = block_capacity - 1;
+    size_t slot = block_slot(ptr);
+    while (blocks[slot].ptr != ptr) {
+        if (!blocks[slot].ptr)
+            return -1;
+        slot = (slot + 1) & mask;
+    }
+    int64_t size = blocks[slot].size;
+
+    // shift back any following blocks that would no longer be found
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; blocks[next].ptr; next = (next + 1) & mask) {
+        size_t home = block_slot(blocks[next].ptr);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            blocks[hole] = blocks[next];
+            hole = next;
+        }
+    }
+    blocks[hole].ptr = NULL;
+    --block_count;
+    return size;
+}
+
+// dlsym() may itself allocate (e.g. for its error buffer), so while we're
+// looking up the real functions we hand out memory from a small static
+// buffer instead. It's never freed.
+static bool resolving;
+static char bootstrap[4096] __attribute__((aligned(16)));
+static size_t bootstrap_used;
+
+static bool is_bootstrap(void* ptr) {
+    return (char*)ptr >= bootstrap && (char*)ptr < bootstrap + sizeof(bootstrap);
+}
+
+static void* bootstrap_alloc(size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (bootstrap_used + size > sizeof(bootstrap))
+        return NULL;
+    void* ptr = bootstrap + bootstrap_used;
+    bootstrap_used += size;
+    return ptr;
+}
+
+static void resolve(void) {
+    resolving = true;
+    real_malloc = (malloc_fn)dlsym(RTLD_NEXT, "malloc");
+    real_calloc = (calloc_fn)dlsym(RTLD_NEXT, "calloc");
+    real_realloc = (realloc_fn)dlsym(RTLD_NEXT, "realloc");
+    real_free = (free_fn)dlsym(RTLD_NEXT, "free");
+    real_posix_memalign = (posix_memalign_fn)dlsym(RTLD_NEXT, "posix_memalign");
+    real_aligned_alloc = (aligned_alloc_fn)dlsym(RTLD_NEXT, "aligned_alloc");
+    real_memalign = (aligned_alloc_fn)dlsym(RTLD_NEXT, "memalign");
+    real_valloc = (valloc_fn)dlsym(RTLD_NEXT, "valloc");
+    real_pvalloc = (valloc_fn)dlsym(RTLD_NEXT, "pvalloc");
+    real_usable_size = (usable_size_fn)dlsym(RTLD_NEXT, "malloc_usable_size");
+    resolving = false;
+    if (!real_malloc || !real_calloc || !real_realloc || !real_free) {
+        fprintf(stderr, "failed to find the real allocator!\n");
+        abort();
+    }
+}
+
+size_t alloc_block_size(void* ptr, size_t requested) {
+    if (!real_malloc)
+        resolve();
+    return real_usable_size ? real_usable_size(ptr) : requested;
+}
+
+static void track_alloc(void* ptr, size_t requested) {
+    if (!ptr)
+        return;
+    int64_t size = (int64_t)alloc_block_size(ptr, requested);
+    lock_blocks();
+    ++stats.allocations;
+    stats.bytes += requested;
+    if (blocks_insert(ptr, size)) {
+        stats.live += size;
+        if (stats.live > stats.peak)
+            stats.peak = stats.live;
+    }
+    unlock_blocks();
+}
+
+static void track_free(void* ptr) {
+    if (!ptr)
+        return;
+    lock_blocks();
+    int64_t size = blocks_remove(ptr);
+    if (size >= 0) {
+        ++stats.frees;
+        stats.live -= size;
+    }
+    unlock_blocks();
+}
+
+void* malloc(size_t size) {
+    if (!real_malloc) {
+        if (resolving)
+            return bootstrap_alloc(size);
+        resolve();
+    }
+    void* ptr = real_malloc(size);
+    if (tracking)
+        track_alloc(ptr, size);
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+    if (!real_calloc) {
+        // bootstrap memory is static so it's already zeroed
+        if (resolving)
+            return bootstrap_alloc(count * size);
+        resolve();
+    }
+    void* ptr = real_calloc(count, size);
+    if (tracking)
+        track_alloc(ptr, count * size);
+    return ptr;
+}
+
+void* realloc(void* old, size_t size) {
+    if (!real_realloc)
+        resolve();
+
+    // memory from the bootstrap buffer can't be resized in place. we don't
+    // know the size of the old block, but it can't extend past the buffer.
+    if (is_bootstrap(old)) {
+        void* ptr = malloc(size);
+        size_t available = (size_t)(bootstrap + sizeof(bootstrap) - (char*)old);
+        if (ptr)
+            memcpy(ptr, old, size < available ? size : available);
+        return ptr;
+    }
+
+    // if realloc() fails the old block is still live, so we can only
+    // count it as freed afterwards. only its address is used for that.
+    void* ptr = real_realloc(old, size);
+    if (tracking && (ptr || size == 0)) {
+        track_free(old);
+        track_alloc(ptr, size);
+    }
+    return ptr;
+}
+
+void free(void* ptr) {
+    if (is_bootstrap(ptr))
+        return;
+    if (!real_free)
+        resolve();
+    if (tracking)
+        track_free(ptr);
+    real_free(ptr);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (!real_malloc)
+        resolve();
+    if (!real_posix_memalign)
+        return ENOMEM;
+    int ret = real_posix_memalign(out, alignment, size);
+    if (tracking && ret == 0)
+        track_alloc(*out, size);
+    return ret;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    if (!real_malloc)
+        resolve();
+    if (!real_aligned_alloc)
+        return NULL;
+    void* ptr = real_aligned_alloc(alignment, size);
+    if (tracking)
+        track_alloc(ptr, size);
+    return ptr;
+}
+
+// these are obsolete, but the system allocator has them and some libraries
+// still call them. their blocks are freed with free() like any other so we
+// must count them too.
+
+void* memalign(size_t alignment, size_t size) {
+    if (!real_malloc)
+        resolve();
+    if (!real_memalign)
+        return NULL;
+    void* ptr = real_memalign(alignment, size);
+    if (tracking)
+        track_alloc(ptr, size);
+    return ptr;
+}
+
+void* valloc(size_t size) {
+    if (!real_malloc)
+        resolve();
+    if (!real_valloc)
+        return NULL;
+    void* ptr = real_valloc(size);
+    if (tracking)
+        track_alloc(ptr, size);
+    return ptr;
+}
+
+void* pvalloc(size_t size) {
+    if (!real_malloc)
+        resolve();
+    if (!real_pvalloc)
+        return NULL;
+    void* ptr = real_pvalloc(size);
+    if (tracking)
+        track_alloc(ptr, size);
+    return ptr;
+}
+
+void alloc_tracking_start(void) {
+    lock_blocks();
+    memset(&stats, 0, sizeof(stats));
+    if (blocks)
+        memset(blocks, 0, block_capacity * sizeof(block_t));
+    block_count = 0;
+    unlock_blocks();
+    __atomic_store_n(&tracking, true, __ATOMIC_SEQ_CST);
+}
+
+void alloc_tracking_stop(alloc_stats_t* out) {
+    __atomic_store_n(&tracking, false, __ATOMIC_SEQ_CST);
+    lock_blocks();
+    *out = stats;
+    unlock_blocks();
+}
+
+const char* alloc_name(void) {
+    static char name[64];
+    if (!real_malloc)
+        resolve();
+    Dl_info info;
+    if (!dladdr((void*)real_malloc, &info) || !info.dli_fname)
+        return "unknown";
+
+    // e.g. "/usr/lib/libjemalloc.so.2" becomes "jemalloc"
+    const char* file = strrchr(info.dli_fname, '/');
+    file = file ? file + 1 : info.dli_fname;
+    if (strncmp(file, "lib", 3) == 0)
+        file += 3;
+    size_t length = strcspn(file, ".");
+    if (length >= sizeof(name))
+        length = sizeof(name) - 1;
+    memcpy(name, file, length);
+    name[length] = '\0';
+
+    // libc.so is glibc's, and gperftools also has a minimal tcmalloc
+    if (strcmp(name, "c") == 0)
+        return "glibc";
+    if (strncmp(name, "tcmalloc", 8) == 0)
+        return "tcmalloc";
+    return name;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_ALLOC_H
+#define BENCHMARK_ALLOC_H 1
+
+// The harness interposes malloc(), calloc(), realloc() and free() (and the
+// aligned variants) so that it can count the allocations made by a test.
+// The real allocator is found with dlsym(RTLD_NEXT), so this works with
+// the system allocator as well as any allocator that is preloaded.
+//
+// Tracking is off except while the harness is explicitly measuring, so
+// outside of that the only cost is an extra call and a branch.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct alloc_stats_t {
+    uint64_t allocations; // calls to malloc(), calloc(), realloc(), etc.
+    uint64_t frees;       // of blocks allocated since tracking started
+    uint64_t bytes;       // total bytes requested
+    int64_t live;         // bytes currently allocated since tracking started
+    int64_t peak;         // the highest value of live
+} alloc_stats_t;
+
+// Resets the counters and starts tracking.
+void alloc_tracking_start(void);
+
+// Stops tracking and gets the counters.
+void alloc_tracking_stop(alloc_stats_t* stats);
+
+// Returns the size that tracking counts for a block: its usable size, or
+// the requested size if the allocator can't tell.
+size_t alloc_block_size(void* ptr, size_t requested);
+
+// Returns the name of the allocator behind malloc() (e.g. "glibc", or
+// "jemalloc" if it's preloaded), from the library that provides it.
+const char* alloc_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,8 +22,36 @@
 // This is the benchmarking framework for C/C++ serialization libraries.
 
 #include "benchmark.h"
+#include "plugin.h"
+#include "histogram.h"
+#include "counters.h"
+#include "alloc.h"
+#include "stats.h"
+#include "environment.h"
+#include "tsc.h"
+#include "mapfile.h"
+#include "profiler.h"
 
+#include <math.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if BENCHMARK_RUNNER
+// In the plugin runner the test functions are those of the plugin being
+// run. Otherwise they're linked directly into the executable, so the timed
+// loop calls run_test() directly as it always has.
+static const benchmark_plugin_t* plugin;
+#define is_benchmark  (*plugin->is_benchmark)
+#define run_test      (*plugin->run_test)
+#define setup_test    (*plugin->setup_test)
+#define teardown_test (*plugin->teardown_test)
+#define test_language (*plugin->test_language)
+#define test_version  (*plugin->test_version)
+#define test_format   (*plugin->test_format)
+#define test_filename (*plugin->test_filename)
+#endif
 
 // with the below seed:
 //   size 2:   2556 bytes MessagePack,   3349 bytes JSON
@@ -32,8 +60,23 @@
 
 #define FRAGMENT_MEMORY 1
 
-#define WORK_TIME 10.0              // work for this many seconds
-#define WARM_TIME (WORK_TIME / 4.0) // warm up for this many seconds
+#define WORK_TIME 10.0              // work for at most this many seconds
+#define WARM_TIME (WORK_TIME / 4.0) // warm up for at most this many seconds
+
+// By default the run is adaptive. The number of iterations per batch is
+// calibrated so that a batch takes about BATCH_TIME. The warm-up ends once
+// the time per iteration of the last few batches is steady. The work phase
+// ends once the 95% confidence interval of the mean batch time is within
+// CI_TARGET of the mean, or at the time limits above. With -f (and with
+// multiple threads, since they must all run for the same time) the warm-up
+// and work phases always run for the full time as they used to.
+#define BATCH_TIME 0.01
+#define MIN_WARM_TIME 0.1
+#define MIN_WORK_TIME 0.5
+#define MIN_BATCHES 10
+#define STEADY_BATCHES 8      // compare the first half of these to the second half
+#define STEADY_TOLERANCE 0.02 // relative difference between the halves
+#define CI_TARGET 0.01        // relative half-width of the confidence interval
 
 static double dtime(void) {
     struct timespec ts;
@@ -41,6 +84,13 @@ static double dtime(void) {
     return (double)ts.tv_sec + (double)ts.tv_nsec / (1000.0 * 1000.0 * 1000.0);
 }
 
+// the current time in nanoseconds, for timing individual iterations
+static uint64_t ntime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
 // We wrap run function here to ensure it cannot be considered for inlining.
 // This is to help prevent the compiler from optimizing away parts of the test.
 __attribute__((noinline)) static bool run_wrapper(uint32_t* hash_out) {
@@ -48,50 +98,1288 @@ __attribute__((noinline)) static bool run_wrapper(uint32_t* hash_out) {
     return run_test(hash_out);
 }
 
+// In corpus mode (-m M) the tests cycle through M documents generated with
+// different seeds, so that the branch predictor can't learn a single
+// document. File tests write each document of the corpus to its own file.
+static int corpus_size = 1;
+static int corpus_member = 0; // the document being written by a file test
+static object_t** corpus_objects;
+
+// The types each format can encode natively. Values of other types are
+// generated as the nearest type the format supports (see
+// generator_support()); formats not listed (e.g. the C structs of
+// hash-object) support every type.
+typedef struct format_support_t {
+    const char* format;
+    int types;
+} format_support_t;
+
+static const format_support_t format_support[] = {
+    {"MessagePack", GENERATOR_SUPPORTS_ALL},
+    {"BSON",        GENERATOR_SUPPORTS_BIN | GENERATOR_SUPPORTS_NONFINITE},
+    {"Binn",        GENERATOR_SUPPORTS_FLOAT | GENERATOR_SUPPORTS_BIN | GENERATOR_SUPPORTS_UINT64 |
+                    GENERATOR_SUPPORTS_NONFINITE},
+    {"UBJSON",      0},
+    {"JSON",        0},
+};
+
+static int test_support(void) {
+    for (size_t i = 0; i < sizeof(format_support) / sizeof(*format_support); ++i)
+        if (strcmp(test_format(), format_support[i].format) == 0)
+            return format_support[i].types;
+    return GENERATOR_SUPPORTS_ALL;
+}
+
+static object_t* create_object(int member, size_t object_size) {
+    generator_support(test_support());
+    if (object_size > BENCHMARK_SIZE_MAX)
+        return object_create_sized(BENCHMARK_OBJECT_SEED + member, object_size);
+    return object_create(BENCHMARK_OBJECT_SEED + member, (int)object_size);
+}
+
 object_t* benchmark_object_create(size_t object_size) {
-    return object_create(BENCHMARK_OBJECT_SEED, object_size);
+    // file tests write one document of the corpus at a time
+    if (corpus_size == 1 || !is_benchmark())
+        return create_object(corpus_member, object_size);
+
+    // benchmarks get the whole corpus. the first document is the test's
+    // root object, and benchmark_object() rotates through all of them.
+    corpus_objects = (object_t**)calloc(corpus_size, sizeof(object_t*));
+    for (int i = 0; i < corpus_size; ++i)
+        corpus_objects[i] = create_object(i, object_size);
+    return corpus_objects[0];
+}
+
+// The data is generated with a workload profile (-G NAME), which is either
+// built in or loaded from a file. Data files of profiles other than the
+// default have the profile's name in their filenames.
+static generator_profile_t loaded_profile;
+
+static const char* workload_name(void) {
+    return generator_profile()->name;
+}
+
+// The first document of a corpus has the usual filename, so a corpus of
+// one is the same as not using a corpus.
+static void corpus_filename(char* buf, size_t size, size_t object_size,
+        const char* format, const char* config, int member)
+{
+    char workload[40] = "";
+    if (generator_profile() != &generator_profiles[0])
+        snprintf(workload, sizeof(workload), "-%s", workload_name());
+    if (member == 0)
+        snprintf(buf, size, "build/data%s%s-%i.%s", config ? config : "", workload, (int)object_size, format);
+    else
+        snprintf(buf, size, "build/data%s%s-%i-c%i.%s", config ? config : "", workload, (int)object_size, member, format);
 }
 
 void benchmark_filename(char* buf, size_t size, size_t object_size, const char* format, const char* config) {
-    snprintf(buf, size, "build/data%s-%i.%s", config ? config : "", (int)object_size, format);
+    corpus_filename(buf, size, object_size, format, config, corpus_member);
 }
 
+// Memory is pre-fragmented according to a heap profile (-F NAME). We
+// allocate a bunch of random-sized blobs, shuffle them and free some of
+// them, optionally for several rounds of reallocating the freed blobs.
+// This creates a more realistic memory layout, testing how well the
+// library deals with real-world memory usage rather than a nice flat
+// empty malloc(). Blob sizes are min_size shifted left by up to
+// shifts - 1 bits, plus up to 7 bytes.
+typedef struct heap_profile_t {
+    const char* name;
+    int count;        // the number of blobs
+    size_t min_size;
+    int shifts;
+    int free_percent; // the share of blobs freed in each round
+    int rounds;       // rounds of reallocating the freed blobs and freeing again
+    bool churn;       // whether to keep reallocating blobs between iterations
+} heap_profile_t;
+
+static const heap_profile_t heap_profiles[] = {
+    // a fresh heap
+    {"pristine", 0, 0, 0, 0, 0, false},
+    // the classic recipe. with this random seed, it peaks at about 22 megs
+    // before freeing half.
+    {"default", 65536, 1, 12, 50, 0, false},
+    // many small objects freed and reallocated over and over, leaving the
+    // small bins full of scattered holes
+    {"churn", 262144, 16, 5, 75, 4, false},
+    // blocks of 4 to 64 KB (below glibc's mmap threshold, so they stay in
+    // the heap) with half freed, leaving large holes between live blocks
+    {"large", 2048, 4096, 5, 50, 0, false},
+    // the default layout, then a long-running server that keeps allocating
+    // and freeing between iterations of the test
+    {"server", 65536, 1, 12, 50, 0, true},
+};
+
+#define HEAP_PROFILE_COUNT (sizeof(heap_profiles) / sizeof(*heap_profiles))
+#define HEAP_PROFILE_DEFAULT 1
+
+// In the server profile each iteration is preceded by CHURN_STEP blobs
+// being freed and reallocated with new sizes. The churn isn't timed, so
+// iterations are timed individually as when evicting.
+#define CHURN_STEP 16
+
+static const heap_profile_t* heap_profile = &heap_profiles[HEAP_PROFILE_DEFAULT];
+
 #if FRAGMENT_MEMORY
-#define MEMORY_COUNT 65536
-static void* memory[MEMORY_COUNT];
+static void** memory;
+static int memory_count;
+static int memory_freed; // blobs [0, memory_freed) are freed
 #endif
 
+#if FRAGMENT_MEMORY
+static size_t blob_size(random_t* random) {
+    return (heap_profile->min_size << (random_next(random) % heap_profile->shifts)) + random_next(random) % 8;
+}
+#endif
+
+static bool heap_churn(void) {
+    #if FRAGMENT_MEMORY
+    return heap_profile->churn;
+    #else
+    return false;
+    #endif
+}
+
 static void fragment_memory(void) {
     #if FRAGMENT_MEMORY
-    // Pre-fragment memory. We allocate a bunch of random-sized blobs,
-    // shuffle them and free half of them. This creates a more realistic
-    // memory layout, testing how well the library deals with real-world
-    // memory usage rather than a nice flat empty malloc().
-    // With this random seed, it peaks at about 22 megs before freeing half.
+    memory_count = heap_profile->count;
+    memory_freed = memory_count * heap_profile->free_percent / 100;
+    if (memory_count == 0)
+        return;
+    memory = (void**)malloc(memory_count * sizeof(void*));
     random_t random;
     random_seed(&random, 34986);
-    for (int i = 0; i < MEMORY_COUNT; ++i) {
-        size_t bytes = (1 << (random_next(&random) % 12)) + random_next(&random) % 8;
-        memory[i] = malloc(bytes);
+    for (int i = 0; i < memory_count; ++i)
+        memory[i] = malloc(blob_size(&random));
+    for (int round = 0; ; ++round) {
+        for (int i = 0; i < memory_count; ++i) {
+            int j = random_next(&random) % (memory_count - i) + i;
+            void* l = memory[i];
+            memory[i] = memory[j];
+            memory[j] = l;
+        }
+        for (int i = 0; i < memory_freed; ++i)
+            free(memory[i]);
+        if (round == heap_profile->rounds)
+            break;
+        for (int i = 0; i < memory_freed; ++i)
+            memory[i] = malloc(blob_size(&random));
     }
-    for (int i = 0; i < MEMORY_COUNT; ++i) {
-        int j = random_next(&random) % (MEMORY_COUNT - i) + i;
-        void* l = memory[i];
-        memory[i] = memory[j];
-        memory[j] = l;
+    #endif
+}
+
+// Frees and reallocates a few of the blobs that are still live, from the
+// range of blobs owned by the calling worker thread.
+static void churn_memory(random_t* random, int begin, int end) {
+    #if FRAGMENT_MEMORY
+    for (int i = 0; i < CHURN_STEP && end > begin; ++i) {
+        int j = begin + (int)(random_next(random) % (uint32_t)(end - begin));
+        free(memory[j]);
+        memory[j] = malloc(blob_size(random));
     }
-    for (int i = 0; i < MEMORY_COUNT / 2; ++i)
-        free(memory[i]);
+    #else
+    (void)random;
+    (void)begin;
+    (void)end;
     #endif
 }
 
 static void free_fragmented_memory(void) {
     #if FRAGMENT_MEMORY
-    for (int i = MEMORY_COUNT / 2; i < MEMORY_COUNT; ++i)
+    for (int i = memory_freed; i < memory_count; ++i)
         free(memory[i]);
+    free(memory);
+    memory = NULL;
+    memory_count = 0;
     #endif
 }
 
+// The number of threads to run the test on concurrently (-t N), or
+// whether to sweep the thread count from 1 up to the number of cores (-T).
+static int thread_count = 1;
+static bool thread_sweep = false;
+
+// Whether to time every iteration individually and record the latencies
+// in a histogram (-l). This adds the overhead of reading the clock to
+// every iteration, so it's off by default; the mean time per iteration
+// is still measured over whole batches either way.
+static bool record_latency = false;
+
+// Whether to time iterations with the TSC (-x). This implies -l. The
+// overhead of reading the TSC is measured and subtracted from every
+// iteration, and the time per iteration is the sum of the iteration times
+// rather than the time of whole batches, so that neither includes the
+// timer. This falls back to the monotonic clock if there's no invariant TSC.
+static bool use_tsc = false;
+static double tsc_ticks_per_ns;
+static uint64_t tsc_overhead_ticks;
+
+static uint64_t iteration_start(void) {
+    return use_tsc ? tsc_start() : ntime();
+}
+
+// the time in nanoseconds since iteration_start()
+static uint64_t iteration_time(uint64_t start) {
+    if (!use_tsc)
+        return ntime() - start;
+    uint64_t ticks = tsc_stop() - start;
+    ticks = ticks > tsc_overhead_ticks ? ticks - tsc_overhead_ticks : 0;
+    return (uint64_t)((double)ticks / tsc_ticks_per_ns + 0.5);
+}
+
+// Whether to time the parse, traverse and free phases of tree tests
+// separately (-b). The tests mark the phases with benchmark_phase_begin()
+// and each mark reads the timer, so this is off by default. Only the work
+// phase is timed; each thread accumulates the time of each phase in the
+// units of iteration_start() until the end of the work phase.
+bool benchmark_phases = false;
+
+static _Thread_local bool phase_timing;
+static _Thread_local int phase_current = BENCHMARK_PHASE_COUNT;
+static _Thread_local uint64_t phase_start;
+static _Thread_local uint64_t phase_totals[BENCHMARK_PHASE_COUNT];
+
+static const char* const phase_names[BENCHMARK_PHASE_COUNT] = {"parse", "traverse", "free"};
+
+void benchmark_phase_mark(benchmark_phase_t phase) {
+    if (!phase_timing || (phase_current == BENCHMARK_PHASE_COUNT && phase == BENCHMARK_PHASE_COUNT))
+        return;
+    uint64_t now = iteration_start();
+    if (phase_current != BENCHMARK_PHASE_COUNT) {
+        uint64_t elapsed = now - phase_start;
+        if (use_tsc)
+            elapsed = elapsed > tsc_overhead_ticks ? elapsed - tsc_overhead_ticks : 0;
+        phase_totals[phase_current] += elapsed;
+    }
+    phase_current = phase;
+    phase_start = now;
+}
+
+// Whether to measure hardware performance counters over the work phase (-c)
+static bool use_counters = false;
+
+// Whether to always run the full warm-up and work time (-f)
+static bool fixed_time = false;
+
+// Whether doubles are hashed by value rather than skipped (-V). Tests that
+// don't round-trip doubles exactly get a different hash than hash-object.
+bool hash_exact_doubles = false;
+
+// The CPU to pin to (-p), or -1 to run wherever the scheduler puts us.
+// With multiple threads, each thread is pinned to the next CPU along.
+static int pin_cpu = -1;
+
+// Whether to sample call stacks during the work phase (-S). The stacks of
+// each test and size are written to build/profiles for tools/fold.py, and
+// since the sampling perturbs the time, the results aren't written.
+static bool profile = false;
+
+// Whether to lock memory (-L) and use realtime scheduling (-P)
+static bool lock_memory = false;
+static bool realtime_priority = false;
+
+// The calibration spin runs before and after each test. If its time
+// changes by more than DRIFT_TOLERANCE, the clock speed changed during the
+// test (frequency scaling, turbo or thermal throttling) and the result is
+// flagged. The spin time is also written with the result, so results from
+// different tests and runs can be checked against each other.
+#define DRIFT_TOLERANCE 0.03
+static double reference_spin; // at the start of the run
+
+// The environment written with each result
+static char governor[32];
+static const char* smt_state = "";
+
+// The allocator behind malloc(), which is glibc's unless another is
+// preloaded (see ALLOCATOR in the Makefile)
+static const char* allocator = "";
+
+// The size of the data file loaded by the test in setup_test(), if any, or
+// of the data written by a write test. This is used to normalize results
+// per encoded byte.
+static size_t data_size;
+__thread size_t benchmark_output;
+
+// The number of nodes in the test's object (see object_count()), used to
+// normalize results per node. This is averaged over the corpus.
+static double node_count;
+
+// In cold cache mode (-C) we keep several copies of every file loaded by
+// load_data_file() spread over twice the size of the last level cache,
+// and hand out the next one on each iteration. Optionally (-E) we also
+// evict the caches between iterations, in which case each iteration is
+// timed individually so that the eviction isn't included in the time.
+static bool cold_cache = false;
+static bool evict_cache = false;
+
+// In mapped input mode (-M) data files are mapped read-only rather than
+// read into the heap, optionally with MAPFILE_* flags, and parsers that
+// don't modify their input parse the mapping directly. A library that
+// writes to its input is reported rather than crashing.
+static bool map_input = false;
+static int map_flags = 0;
+static char input_mode[48] = "read";
+
+bool benchmark_direct_input = false;
+__thread bool benchmark_input_copied = false;
+__thread char* benchmark_direct_data = NULL;
+__thread size_t benchmark_in_situ_size = 0;
+__thread size_t benchmark_in_situ_usable = 0;
+
+// In huge page mode (-H) data files, in-situ copies, cold copies and
+// buffer_t output buffers are backed by 2 MB huge pages, transparent or
+// (-Ht) from hugetlbfs. Library allocations go through malloc(), which
+// glibc backs with huge pages only if GLIBC_TUNABLES sets
+// glibc.malloc.hugetlb, so we record whether it's set.
+bool benchmark_huge_pages = false;
+static bool use_hugetlb = false;
+static char huge_mode[32] = "";
+
+// Whether the time per iteration is the sum of individually timed
+// iterations rather than the time of whole batches: when evicting or
+// churning the heap, so that the eviction or churn isn't counted, and with
+// the TSC, so that the timer overhead isn't counted.
+static bool busy_time_only(void) {
+    return evict_cache || use_tsc || heap_churn();
+}
+
+// the last level cache size we assume if we can't query it
+#define DEFAULT_CACHE_SIZE (32 * 1024 * 1024)
+
+// Data files loaded by load_data_file() are registered in corpus, cold
+// cache or mapped input mode so that we can substitute other data on each
+// iteration, and know when it can be parsed directly. Each
+// has the documents of the corpus (the first is the loaded file itself)
+// and a list of buffers to rotate through, which are either the documents
+// themselves or cold copies of them, in corpus order.
+typedef struct input_t {
+    char* source;
+    char** documents;
+    size_t* document_sizes;
+    char* copies;
+    size_t copies_size;
+    char** data;
+    size_t* sizes;
+    size_t count;
+} input_t;
+
+// the number of data files a test can load in corpus or cold cache mode
+#define INPUT_MAX 4
+
+static input_t inputs[INPUT_MAX];
+static int input_count;
+
+// the position in the rotation, for both inputs and corpus objects
+static _Thread_local size_t input_index;
+
+static char* evict_buffer;
+static size_t evict_size;
+static volatile uint64_t evict_sink;
+
+static size_t cache_size(void) {
+    #ifdef _SC_LEVEL3_CACHE_SIZE
+    long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size > 0)
+        return (size_t)size;
+    #endif
+    return DEFAULT_CACHE_SIZE;
+}
+
+// Each cold copy is null-terminated (for the parsers that need it) and
+// padded to a whole number of cache lines plus one, so that the copies
+// don't all start in the same cache set.
+static size_t cold_stride(size_t size) {
+    return ((size + 1 + 63) & ~(size_t)63) + 64;
+}
+
+static bool make_cold_copies(input_t* input) {
+    size_t corpus_bytes = 0;
+    for (int i = 0; i < corpus_size; ++i)
+        corpus_bytes += cold_stride(input->document_sizes[i]);
+    size_t rounds = 2 * cache_size() / corpus_bytes;
+    if (rounds < 2)
+        rounds = 2;
+
+    input->copies_size = corpus_bytes * rounds;
+    input->copies = (char*)benchmark_buffer_alloc(input->copies_size);
+    input->count = rounds * corpus_size;
+    input->data = (char**)malloc(input->count * sizeof(char*));
+    input->sizes = (size_t*)malloc(input->count * sizeof(size_t));
+    if (!input->copies || !input->data || !input->sizes) {
+        fprintf(stderr, "out of memory for cold copies!\n");
+        return false;
+    }
+
+    char* copy = input->copies;
+    for (size_t i = 0; i < input->count; ++i) {
+        size_t size = input->document_sizes[i % corpus_size];
+        memcpy(copy, input->documents[i % corpus_size], size);
+        copy[size] = '\0';
+        input->data[i] = copy;
+        input->sizes[i] = size;
+        copy += cold_stride(size);
+    }
+    return true;
+}
+
+static char* load_file(const char* filename, size_t* size_out);
+
+static bool register_input(char* source, size_t size, const char* format,
+        size_t object_size, const char* config)
+{
+    if (input_count == INPUT_MAX) {
+        fprintf(stderr, "too many data files for corpus or cold cache mode!\n");
+        return false;
+    }
+    input_t* input = &inputs[input_count++];
+    memset(input, 0, sizeof(*input));
+    input->source = source;
+
+    // load the rest of the corpus
+    input->documents = (char**)calloc(corpus_size, sizeof(char*));
+    input->document_sizes = (size_t*)calloc(corpus_size, sizeof(size_t));
+    if (!input->documents || !input->document_sizes)
+        return false;
+    input->documents[0] = source;
+    input->document_sizes[0] = size;
+    size_t total_size = size;
+    for (int i = 1; i < corpus_size; ++i) {
+        char filename[64];
+        corpus_filename(filename, sizeof(filename), object_size, format, config, i);
+        input->documents[i] = load_file(filename, &input->document_sizes[i]);
+        if (!input->documents[i]) {
+            fprintf(stderr, "%s is missing! did you run the file tests with the same -m and -G?\n", filename);
+            return false;
+        }
+        total_size += input->document_sizes[i];
+    }
+
+    // results are normalized by the average document size
+    data_size = total_size / corpus_size;
+
+    if (cold_cache)
+        return make_cold_copies(input);
+    input->data = input->documents;
+    input->sizes = input->document_sizes;
+    input->count = corpus_size;
+    return true;
+}
+
+static void clear_inputs(void) {
+    for (int i = 0; i < input_count; ++i) {
+        input_t* input = &inputs[i];
+        if (input->documents) {
+            // the first document is freed by the test
+            for (int j = 1; j < corpus_size; ++j)
+                free_data_file(input->documents[j]);
+        }
+        if (input->copies) {
+            free(input->data);
+            free(input->sizes);
+            benchmark_buffer_free(input->copies);
+        }
+        free(input->documents);
+        free(input->document_sizes);
+    }
+    input_count = 0;
+
+    if (corpus_objects) {
+        // the first object is destroyed by the test
+        for (int i = 1; i < corpus_size; ++i)
+            object_destroy(corpus_objects[i]);
+        free(corpus_objects);
+        corpus_objects = NULL;
+    }
+}
+
+char* benchmark_input(char* source, size_t* size) {
+    for (int i = 0; i < input_count; ++i) {
+        input_t* input = &inputs[i];
+        if (input->source == source) {
+            size_t index = input_index++ % input->count;
+            *size = input->sizes[index];
+            // in cold cache and mapped input modes, every registered
+            // buffer is a cold copy or a mapping
+            benchmark_direct_data = benchmark_direct_input ? input->data[index] : NULL;
+            return input->data[index];
+        }
+    }
+    benchmark_direct_data = NULL;
+    return source;
+}
+
+object_t* benchmark_object(object_t* root) {
+    if (corpus_objects && root == corpus_objects[0])
+        return corpus_objects[input_index++ % corpus_size];
+    return root;
+}
+
+// Evicts the caches by reading a cache line at a time from a buffer
+// twice the size of the last level cache.
+static void evict(void) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < evict_size; i += 64)
+        sum += (uint8_t)evict_buffer[i];
+    evict_sink = sum;
+}
+
+static const char* cache_label(void) {
+    if (evict_cache)
+        return "evict";
+    if (cold_cache)
+        return "cold";
+    return "warm";
+}
+
+// Resource usage of the whole process from getrusage(). Page faults are
+// cumulative so we report the difference over each phase. The max RSS is a
+// process-wide high water mark, so on Linux we reset it at the start of each
+// phase (by writing 5 to /proc/self/clear_refs) and read it back from VmHWM
+// in /proc/self/status; each phase then reports its own peak above the RSS
+// it started with, regardless of earlier sizes, threads or plugins. Where
+// it can't be reset we fall back to its growth above the baseline taken
+// after fragmenting memory.
+typedef struct usage_t {
+    long minor_faults;
+    long major_faults;
+    long max_rss;   // in KB
+    long start_rss; // in KB, right after resetting the high water mark
+} usage_t;
+
+static usage_t baseline_usage;
+static bool resettable_rss = false;
+
+#ifdef __linux__
+// Reads a "Name:   1234 kB" line from /proc/self/status, or -1.
+static long read_status_kb(const char* key) {
+    FILE* file = fopen("/proc/self/status", "r");
+    if (!file)
+        return -1;
+    size_t key_length = strlen(key);
+    char line[256];
+    long value = -1;
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, key, key_length) == 0 && line[key_length] == ':') {
+            value = strtol(line + key_length + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(file);
+    return value;
+}
+#endif
+
+// Resets the RSS high water mark to the current RSS.
+static bool reset_peak_rss(void) {
+    #ifdef __linux__
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (!file)
+        return false;
+    bool ok = fputs("5", file) >= 0;
+    return fclose(file) == 0 && ok;
+    #else
+    return false;
+    #endif
+}
+
+static void get_usage(usage_t* usage) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    usage->minor_faults = ru.ru_minflt;
+    usage->major_faults = ru.ru_majflt;
+    #ifdef __APPLE__
+    usage->max_rss = ru.ru_maxrss / 1024; // bytes on macOS
+    #else
+    usage->max_rss = ru.ru_maxrss;
+    #endif
+    #ifdef __linux__
+    // ru_maxrss isn't affected by clear_refs
+    if (resettable_rss) {
+        long hwm = read_status_kb("VmHWM");
+        if (hwm >= 0)
+            usage->max_rss = hwm;
+    }
+    #endif
+    usage->start_rss = usage->max_rss;
+}
+
+// Gets the usage at the end of the previous phase (if any) and starts a new
+// one by resetting the high water mark.
+static void start_usage(usage_t* usage) {
+    get_usage(usage);
+    if (resettable_rss && reset_peak_rss()) {
+        #ifdef __linux__
+        long hwm = read_status_kb("VmHWM");
+        if (hwm >= 0)
+            usage->start_rss = hwm;
+        #endif
+    }
+}
+
+// The page faults during a phase and its peak RSS above where it started
+typedef struct phase_t {
+    long minor_faults;
+    long major_faults;
+    long peak_rss;
+} phase_t;
+
+static void get_phase(phase_t* phase, const usage_t* start, const usage_t* end) {
+    phase->minor_faults = end->minor_faults - start->minor_faults;
+    phase->major_faults = end->major_faults - start->major_faults;
+    if (resettable_rss)
+        phase->peak_rss = end->max_rss - start->start_rss;
+    else
+        phase->peak_rss = end->max_rss - baseline_usage.max_rss;
+}
+
+// Each thread runs the test independently for the full warm-up and work
+// time. The tests don't modify their input data or root object while
+// running (parsing tests make their own in-situ copies on every iteration)
+// so the threads can share the data set up by setup_test().
+typedef struct worker_t {
+    pthread_t thread;
+    pthread_barrier_t* barrier;
+    histogram_t* latency;
+    counters_t* counters; // only on a single thread run; otherwise the main thread handles them
+    usage_t* work_usage;  // as above
+    bool profile;         // as above
+    int iterations;
+    int cpu;            // the CPU to pin this thread to, or -1
+    bool ok;
+    int total_iterations;
+    double start_time;
+    double end_time;
+    uint64_t busy_time; // nanoseconds spent running the test when evicting between iterations
+    uint32_t hash_result;
+    bool adaptive;
+    double warm_time;   // the time actually spent warming up
+    stats_t batches;    // time per iteration of each batch, in microseconds
+    random_t churn_random; // for churning the heap between iterations
+    int churn_begin;    // the range of fragmentation blobs this thread churns
+    int churn_end;
+    uint64_t phase_totals[BENCHMARK_PHASE_COUNT]; // in the units of iteration_start()
+} worker_t;
+
+// Returns true if the last STEADY_BATCHES batch times (in a ring buffer) are
+// steady, i.e. the mean of the older half is close to the mean of the newer.
+static bool is_steady(const double* batches, int count) {
+    if (count < STEADY_BATCHES)
+        return false;
+    double older = 0, newer = 0;
+    for (int i = 0; i < STEADY_BATCHES / 2; ++i) {
+        older += batches[(count + i) % STEADY_BATCHES];
+        newer += batches[(count + i + STEADY_BATCHES / 2) % STEADY_BATCHES];
+    }
+    return fabs(newer - older) <= STEADY_TOLERANCE * newer;
+}
+
+static void* run_worker(void* arg) {
+    worker_t* worker = (worker_t*)arg;
+    worker->ok = false;
+    if (worker->cpu >= 0 && !environment_pin(worker->cpu))
+        fprintf(stderr, "failed to pin thread to CPU %i\n", worker->cpu);
+
+    // warm up
+    bool ok = true;
+    double start_time = dtime();
+    double batch_start = start_time;
+    double batches[STEADY_BATCHES];
+    int batch_count = 0;
+    while (ok) {
+        for (int i = 0; i < worker->iterations; ++i) {
+            worker->hash_result = 0;
+            if (heap_churn())
+                churn_memory(&worker->churn_random, worker->churn_begin, worker->churn_end);
+            if (!run_wrapper(&worker->hash_result)) {
+                ok = false;
+                break;
+            }
+        }
+        double now = dtime();
+        worker->warm_time = now - start_time;
+        if (worker->warm_time > WARM_TIME)
+            break;
+        if (worker->adaptive) {
+            batches[batch_count++ % STEADY_BATCHES] = (now - batch_start) / worker->iterations;
+            if (worker->warm_time > MIN_WARM_TIME && is_steady(batches, batch_count))
+                break;
+        }
+        batch_start = now;
+    }
+
+    // all threads start the timed loop together (even if one of them
+    // failed, otherwise the rest would wait forever)
+    if (worker->barrier)
+        pthread_barrier_wait(worker->barrier);
+    if (!ok)
+        return NULL;
+
+    // run tests
+    if (worker->work_usage)
+        start_usage(worker->work_usage);
+    if (worker->counters)
+        counters_start(worker->counters);
+    if (worker->profile)
+        profiler_start();
+    worker->total_iterations = 0;
+    phase_timing = benchmark_phases;
+    phase_current = BENCHMARK_PHASE_COUNT;
+    memset(phase_totals, 0, sizeof(phase_totals));
+    worker->start_time = dtime();
+    stats_clear(&worker->batches);
+    while (true) {
+        double batch_start = dtime();
+        uint64_t batch_busy = worker->busy_time;
+        for (int i = 0; i < worker->iterations; ++i) {
+            worker->hash_result = HASH_INITIAL_VALUE;
+            if (worker->latency || busy_time_only()) {
+                if (evict_cache)
+                    evict();
+                if (heap_churn())
+                    churn_memory(&worker->churn_random, worker->churn_begin, worker->churn_end);
+                uint64_t start = iteration_start();
+                ok = run_wrapper(&worker->hash_result);
+                uint64_t time = iteration_time(start);
+                if (!ok)
+                    break;
+                if (worker->latency)
+                    histogram_record(worker->latency, time);
+                worker->busy_time += time;
+            } else {
+                ok = run_wrapper(&worker->hash_result);
+                if (!ok)
+                    break;
+            }
+            // in case the test didn't end its last phase
+            if (benchmark_phases)
+                benchmark_phase_mark(BENCHMARK_PHASE_COUNT);
+            ++worker->total_iterations;
+        }
+        worker->end_time = dtime();
+        if (!ok)
+            break;
+
+        // when evicting or using the TSC, only the time spent in the test itself counts
+        double batch_time = worker->end_time - batch_start;
+        if (busy_time_only())
+            batch_time = (double)(worker->busy_time - batch_busy) / (1000.0 * 1000.0 * 1000.0);
+        stats_add(&worker->batches, batch_time / worker->iterations * (1000.0 * 1000.0));
+
+        double elapsed = worker->end_time - worker->start_time;
+        if (elapsed > WORK_TIME)
+            break;
+        if (worker->adaptive && elapsed > MIN_WORK_TIME && worker->batches.count >= MIN_BATCHES &&
+                stats_ci(&worker->batches) <= CI_TARGET * worker->batches.mean)
+            break;
+    }
+    // a failed test must still stop the profiler and counters, which
+    // otherwise stay armed for the next test in the plugin runner
+    if (worker->profile)
+        profiler_stop();
+    if (worker->counters)
+        counters_stop(worker->counters);
+    phase_timing = false;
+    memcpy(worker->phase_totals, phase_totals, sizeof(phase_totals));
+
+    worker->ok = ok;
+    return NULL;
+}
+
+typedef struct result_t {
+    int threads;
+    int total_iterations;
+    double elapsed;   // wall time from the first thread starting to the last finishing
+    double per_time;  // microseconds per iteration on each thread
+    double docs_per_second; // aggregate over all threads
+    uint32_t hash_result;
+    histogram_t* latency;   // merged over all threads, or NULL if not recorded
+    counters_t counters;    // totals over all threads
+    bool has_counters;
+    phase_t warm;
+    phase_t work;
+    double warm_time;
+    double ci;      // half-width of the 95% confidence interval of per_time, in microseconds
+    int batches;
+    double spin;    // calibration spin time before the test, in microseconds
+    double drift;   // relative change in the spin time over the test
+    long huge_kb;   // memory backed by huge pages after the test, or -1 if not known
+    double phase_time[BENCHMARK_PHASE_COUNT]; // microseconds per iteration, or -1 if not timed
+} result_t;
+
+static bool run_threads(bool result_only, const char* name, int threads, int iterations, result_t* result) {
+    bool adaptive = !fixed_time && threads == 1;
+    if (!result_only) {
+        if (adaptive) {
+            printf("%s: warming until steady for up to %.0f seconds\n", name, WARM_TIME);
+            printf("%s: running until the mean is within %.0f%% for up to %.0f seconds\n",
+                    name, CI_TARGET * 100.0, WORK_TIME);
+        } else if (threads == 1) {
+            printf("%s: warming for %.0f seconds \n", name, WARM_TIME);
+            printf("%s: running for %.0f seconds\n", name, WORK_TIME);
+        } else {
+            printf("%s: warming and running %i threads for %.0f seconds\n",
+                    name, threads, WARM_TIME + WORK_TIME);
+        }
+    }
+
+    worker_t* workers = (worker_t*)calloc(threads, sizeof(worker_t));
+    for (int i = 0; i < threads; ++i) {
+        workers[i].iterations = iterations;
+        workers[i].adaptive = adaptive;
+
+        // a single thread runs on the main thread, which is already pinned
+        workers[i].cpu = -1;
+        if (pin_cpu >= 0 && threads > 1)
+            workers[i].cpu = (pin_cpu + i) % environment_cpu_count();
+        if (record_latency) {
+            workers[i].latency = (histogram_t*)malloc(sizeof(histogram_t));
+            histogram_clear(workers[i].latency);
+        }
+
+        // each thread churns its own share of the live blobs
+        #if FRAGMENT_MEMORY
+        int live = memory_count - memory_freed;
+        workers[i].churn_begin = memory_freed + live * i / threads;
+        workers[i].churn_end = memory_freed + live * (i + 1) / threads;
+        random_seed(&workers[i].churn_random, 34986 + i);
+        #endif
+    }
+
+    // hardware counters are opened on the main thread before starting any
+    // workers so they are inherited by all of them
+    result->has_counters = use_counters && counters_open(&result->counters);
+    if (use_counters && !result->has_counters && !result_only)
+        printf("%s: hardware performance counters are not available\n", name);
+
+    usage_t warm_usage, work_usage, end_usage;
+    start_usage(&warm_usage);
+
+    // a single thread runs directly on the main thread as it always has
+    if (threads == 1) {
+        if (result->has_counters)
+            workers[0].counters = &result->counters;
+        workers[0].profile = profile;
+        workers[0].work_usage = &work_usage;
+        run_worker(&workers[0]);
+    } else {
+        // the main thread waits with the workers so that it can start
+        // the counters when they all start the timed loop
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, threads + 1);
+        int started = 0;
+        for (; started < threads; ++started) {
+            workers[started].barrier = &barrier;
+            if (pthread_create(&workers[started].thread, NULL, run_worker, &workers[started]) != 0)
+                break;
+        }
+        if (started != threads) {
+            // we can't release the threads we did start from the barrier,
+            // so there's nothing to do but bail
+            fprintf(stderr, "%s: failed to start thread %i.\n", name, started);
+            exit(EXIT_FAILURE);
+        }
+        pthread_barrier_wait(&barrier);
+        start_usage(&work_usage);
+        if (result->has_counters)
+            counters_start(&result->counters);
+        if (profile)
+            profiler_start();
+        for (int i = 0; i < threads; ++i)
+            pthread_join(workers[i].thread, NULL);
+        if (profile)
+            profiler_stop();
+        if (result->has_counters)
+            counters_stop(&result->counters);
+        pthread_barrier_destroy(&barrier);
+    }
+    get_usage(&end_usage);
+    get_phase(&result->warm, &warm_usage, &work_usage);
+    get_phase(&result->work, &work_usage, &end_usage);
+    if (result->has_counters)
+        counters_close(&result->counters);
+
+    bool ok = true;
+    double start_time = workers[0].start_time;
+    double end_time = workers[0].end_time;
+    uint64_t busy_time = 0;
+    uint64_t phase_totals[BENCHMARK_PHASE_COUNT] = {0};
+    result->threads = threads;
+    result->total_iterations = 0;
+    result->hash_result = workers[0].hash_result;
+    result->latency = workers[0].latency;
+    result->warm_time = workers[0].warm_time;
+    result->batches = workers[0].batches.count;
+    result->ci = stats_ci(&workers[0].batches);
+    for (int i = 0; i < threads; ++i) {
+        if (!workers[i].ok) {
+            fprintf(stderr, "%s: failed to get benchmark result.\n", name);
+            ok = false;
+            break;
+        }
+        // (in corpus mode the threads may have finished on different documents)
+        if (corpus_size == 1 && workers[i].hash_result != result->hash_result) {
+            fprintf(stderr, "%s: thread %i got hash %08x, expected %08x.\n",
+                    name, i, workers[i].hash_result, result->hash_result);
+            ok = false;
+            break;
+        }
+        if (workers[i].start_time < start_time)
+            start_time = workers[i].start_time;
+        if (workers[i].end_time > end_time)
+            end_time = workers[i].end_time;
+        result->total_iterations += workers[i].total_iterations;
+        busy_time += workers[i].busy_time;
+        for (int j = 0; j < BENCHMARK_PHASE_COUNT; ++j)
+            phase_totals[j] += workers[i].phase_totals[j];
+    }
+    for (int i = 1; i < threads; ++i) {
+        if (workers[i].latency) {
+            histogram_merge(result->latency, workers[i].latency);
+            free(workers[i].latency);
+        }
+    }
+    free(workers);
+    if (!ok) {
+        free(result->latency);
+        return false;
+    }
+
+    result->elapsed = end_time - start_time;
+    result->per_time = result->elapsed * threads / (double)result->total_iterations * (1000.0 * 1000.0);
+    result->docs_per_second = (double)result->total_iterations / result->elapsed;
+
+    // when evicting or using the TSC, only the time spent in the test itself counts
+    if (busy_time_only()) {
+        result->per_time = (double)busy_time / (double)result->total_iterations / 1000.0;
+        result->docs_per_second = threads * (1000.0 * 1000.0) / result->per_time;
+    }
+
+    // tests that don't mark phases have none to report
+    bool phased = false;
+    for (int i = 0; i < BENCHMARK_PHASE_COUNT; ++i)
+        phased = phased || phase_totals[i] != 0;
+    for (int i = 0; i < BENCHMARK_PHASE_COUNT; ++i) {
+        double ns = (double)phase_totals[i];
+        if (use_tsc)
+            ns /= tsc_ticks_per_ns;
+        result->phase_time[i] = phased ? ns / (double)result->total_iterations / 1000.0 : -1;
+    }
+    return true;
+}
+
+// latency percentiles reported in the results, in order
+static const double percentiles[] = {50, 90, 99, 99.9};
+#define PERCENTILE_COUNT (sizeof(percentiles) / sizeof(*percentiles))
+
+static void print_latency(const char* name, const histogram_t* latency) {
+    printf("%s: latency", name);
+    for (size_t i = 0; i < PERCENTILE_COUNT; ++i)
+        printf(" p%g %.3f,", percentiles[i], histogram_percentile(latency, percentiles[i]) / 1000.0);
+    printf(" max %.3f microseconds\n", latency->max / 1000.0);
+}
+
+static void print_counters(const char* name, const result_t* result) {
+    const counters_t* counters = &result->counters;
+    double iterations = (double)result->total_iterations;
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (!counters->valid[i])
+            continue;
+        double per_iteration = counters->values[i] / iterations;
+        printf("%s: %.1f %s per iteration", name, per_iteration, counter_name((counter_t)i));
+        if (data_size != 0 && i != counter_cycles && i != counter_instructions)
+            printf(", %.3f per KB", per_iteration * 1024.0 / (double)data_size);
+        printf("\n");
+    }
+    if (counters->valid[counter_cycles] && counters->valid[counter_instructions])
+        printf("%s: %.2f instructions per cycle\n", name,
+                counters->values[counter_instructions] / counters->values[counter_cycles]);
+}
+
+// The number of iterations over which to count allocations. This is done
+// after the timed loop so that counting doesn't affect the timing.
+#define ALLOC_ITERATIONS 8
+
+typedef struct allocations_t {
+    double allocations; // per iteration
+    double bytes;       // requested per iteration
+    int64_t peak;       // the most bytes live at once during any iteration, less the in-situ copy
+} allocations_t;
+
+static bool count_allocations(const char* name, allocations_t* allocations) {
+    allocations->allocations = 0;
+    allocations->bytes = 0;
+    allocations->peak = 0;
+
+    for (int i = 0; i < ALLOC_ITERATIONS; ++i) {
+        uint32_t hash_result = HASH_INITIAL_VALUE;
+        alloc_stats_t stats;
+        benchmark_in_situ_size = 0;
+        benchmark_in_situ_usable = 0;
+        alloc_tracking_start();
+        bool ok = run_wrapper(&hash_result);
+        alloc_tracking_stop(&stats);
+        if (!ok) {
+            fprintf(stderr, "%s: failed to get benchmark result.\n", name);
+            return false;
+        }
+
+        // the in-situ copy is the harness's, not the library's, so a
+        // parser that never allocates shows no allocations. it's live
+        // for the whole parse so it's part of the peak.
+        if (benchmark_in_situ_size != 0) {
+            stats.allocations -= 1;
+            stats.bytes -= benchmark_in_situ_size;
+        }
+        allocations->allocations += (double)stats.allocations;
+        allocations->bytes += (double)stats.bytes;
+        int64_t peak = stats.peak - (int64_t)benchmark_in_situ_usable;
+        if (peak > allocations->peak)
+            allocations->peak = peak;
+    }
+
+    allocations->allocations /= ALLOC_ITERATIONS;
+    allocations->bytes /= ALLOC_ITERATIONS;
+    return true;
+}
+
+// Doubles the number of iterations until a batch takes at least BATCH_TIME.
+static bool calibrate_iterations(const char* name, int* iterations) {
+    for (*iterations = 1; *iterations < (1 << 24); *iterations *= 2) {
+        double start_time = dtime();
+        for (int i = 0; i < *iterations; ++i) {
+            uint32_t hash_result = HASH_INITIAL_VALUE;
+            if (!run_wrapper(&hash_result)) {
+                fprintf(stderr, "%s: failed to get benchmark result.\n", name);
+                return false;
+            }
+        }
+        if (dtime() - start_time >= BATCH_TIME)
+            break;
+    }
+    return true;
+}
+
+// In corpus mode the hash covers every document of the corpus in order,
+// so it doesn't depend on which document a thread happened to finish on.
+static bool hash_corpus(const char* name, uint32_t* hash_result) {
+    input_index = 0;
+    *hash_result = HASH_INITIAL_VALUE;
+    for (int i = 0; i < corpus_size; ++i) {
+        if (!run_wrapper(hash_result)) {
+            fprintf(stderr, "%s: failed to get benchmark result.\n", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write tests report the size of their output on every iteration. We take
+// its average over the corpus.
+static bool measure_output(const char* name) {
+    size_t total = 0;
+    input_index = 0;
+    for (int i = 0; i < corpus_size; ++i) {
+        uint32_t hash_result = HASH_INITIAL_VALUE;
+        benchmark_output = 0;
+        if (!run_wrapper(&hash_result)) {
+            fprintf(stderr, "%s: failed to get benchmark result.\n", name);
+            return false;
+        }
+        total += benchmark_output;
+    }
+    data_size = total / corpus_size;
+    return true;
+}
+
+// Counts the nodes of the objects the data was generated from. The objects
+// are generated again here rather than during setup so as not to count
+// them in the memory usage of the test.
+static void count_nodes(size_t object_size) {
+    size_t total = 0;
+    for (int i = 0; i < corpus_size; ++i) {
+        object_t* object = create_object(i, object_size);
+        total += object_count(object);
+        object_destroy(object);
+    }
+    node_count = (double)total / corpus_size;
+}
+
+static void print_throughput(const char* name, const result_t* result) {
+    printf("%s: %.2f million nodes per second", name, node_count / result->per_time);
+    if (data_size != 0) {
+        printf(", %.1f MB/s", (double)data_size / result->per_time);
+        if (result->has_counters && result->counters.valid[counter_cycles])
+            printf(", %.3f bytes per cycle", (double)data_size * result->total_iterations /
+                    result->counters.values[counter_cycles]);
+    }
+    printf("\n");
+}
+
+static void print_allocations(const char* name, const allocations_t* allocations) {
+    printf("%s: %.1f allocations totalling %.0f bytes per iteration\n",
+            name, allocations->allocations, allocations->bytes);
+    printf("%s: %" PRIi64 " bytes peak heap usage", name, allocations->peak);
+    if (data_size != 0)
+        printf(", %.2fx memory amplification", (double)allocations->peak / (double)data_size);
+    printf("\n");
+}
+
+static void print_phase(const char* name, const char* phase_name, const phase_t* phase) {
+    printf("%s: %s: %li minor and %li major page faults, peak RSS +%li KB\n", name,
+            phase_name, phase->minor_faults, phase->major_faults, phase->peak_rss);
+}
+
+static void print_phases(const char* name, const result_t* result) {
+    double total = 0;
+    for (int i = 0; i < BENCHMARK_PHASE_COUNT; ++i)
+        total += result->phase_time[i];
+    printf("%s: phases:", name);
+    for (int i = 0; i < BENCHMARK_PHASE_COUNT; ++i)
+        printf(" %s %.3f (%.1f%%),", phase_names[i], result->phase_time[i],
+                100.0 * result->phase_time[i] / result->per_time);
+    printf(" other %.3f microseconds per iteration\n", result->per_time - total);
+}
+
+static void write_result(const char* name, size_t object_size, size_t binary_size,
+        const result_t* result, const allocations_t* allocations, const phase_t* setup,
+        bool mapped, bool zero_copy)
+{
+    FILE* file = fopen("results.csv", "a");
+    fprintf(file, "\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",%i,%f,%i,%i,\"%08x\",%i",
+            name, test_language(), test_version(), test_filename(), test_format(),
+            (int)object_size, result->per_time, (int)binary_size,
+            #if BENCHMARK_SIZE_OPTIMIZED
+            1,
+            #else
+            0,
+            #endif
+            result->hash_result, result->threads);
+
+    // latency percentiles and max in microseconds (empty if not recorded)
+    for (size_t i = 0; i < PERCENTILE_COUNT; ++i) {
+        if (result->latency)
+            fprintf(file, ",%f", histogram_percentile(result->latency, percentiles[i]) / 1000.0);
+        else
+            fprintf(file, ",");
+    }
+    if (result->latency)
+        fprintf(file, ",%f", result->latency->max / 1000.0);
+    else
+        fprintf(file, ",");
+
+    // size of the encoded data (0 if not known), followed by hardware
+    // counters per iteration (empty if not measured)
+    fprintf(file, ",%i", (int)data_size);
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (result->has_counters && result->counters.valid[i])
+            fprintf(file, ",%f", result->counters.values[i] / (double)result->total_iterations);
+        else
+            fprintf(file, ",");
+    }
+
+    // allocations and bytes allocated per iteration, and peak heap usage
+    fprintf(file, ",%f,%f,%" PRIi64, allocations->allocations, allocations->bytes, allocations->peak);
+
+    // page faults and peak RSS above the start of each phase (in KB) for the setup,
+    // warm-up and work phases. work phase faults are per iteration.
+    fprintf(file, ",%li,%li,%li", setup->minor_faults, setup->major_faults, setup->peak_rss);
+    fprintf(file, ",%li,%li,%li", result->warm.minor_faults, result->warm.major_faults, result->warm.peak_rss);
+    fprintf(file, ",%f,%f,%li",
+            (double)result->work.minor_faults / (double)result->total_iterations,
+            (double)result->work.major_faults / (double)result->total_iterations,
+            result->work.peak_rss);
+
+    // whether the input was in cache ("warm"), rotated through cold copies
+    // ("cold"), or also evicted between iterations ("evict")
+    fprintf(file, ",\"%s\"", cache_label());
+
+    // the number of documents in the corpus
+    fprintf(file, ",%i", corpus_size);
+
+    // half-width of the 95% confidence interval of the time (empty if
+    // there weren't enough batches to measure it)
+    if (isfinite(result->ci))
+        fprintf(file, ",%f", result->ci);
+    else
+        fprintf(file, ",");
+
+    // the pinned CPU (empty if not pinned), the CPU frequency governor and
+    // SMT state (empty if not known), and the calibration spin time in
+    // microseconds and its relative change over the test
+    if (pin_cpu >= 0)
+        fprintf(file, ",%i", pin_cpu);
+    else
+        fprintf(file, ",");
+    fprintf(file, ",\"%s\",\"%s\",%f,%f", governor, smt_state, result->spin, result->drift);
+
+    // the timer for individual iterations ("tsc", or "clock" for the
+    // monotonic clock whether or not iterations were timed)
+    fprintf(file, ",\"%s\"", use_tsc ? "tsc" : "clock");
+
+    // the number of nodes in the object
+    fprintf(file, ",%f", node_count);
+
+    // how the data file was loaded ("read", or "mmap" followed by its
+    // flags), and in mapped mode whether the test parsed the mapping
+    // directly (1) or a copy of it (0; empty if not mapped)
+    fprintf(file, ",\"%s\"", input_mode);
+    if (mapped)
+        fprintf(file, ",%i", zero_copy ? 1 : 0);
+    else
+        fprintf(file, ",");
+
+    // the huge pages backing buffers ("thp" or "hugetlb", followed by
+    // "+malloc" if malloc() used them too; empty if not used) and the
+    // memory backed by huge pages in KB (empty if not known)
+    fprintf(file, ",\"%s\"", huge_mode);
+    if (result->huge_kb >= 0)
+        fprintf(file, ",%li", result->huge_kb);
+    else
+        fprintf(file, ",");
+
+    // the allocator behind malloc(), and the heap profile
+    fprintf(file, ",\"%s\",\"%s\"", allocator, heap_profile->name);
+
+    // microseconds per iteration in the parse, traverse and free phases of
+    // a tree test (empty if not timed)
+    for (int i = 0; i < BENCHMARK_PHASE_COUNT; ++i) {
+        if (result->phase_time[i] >= 0)
+            fprintf(file, ",%f", result->phase_time[i]);
+        else
+            fprintf(file, ",");
+    }
+
+    // the workload profile the data was generated with
+    fprintf(file, ",\"%s\"", workload_name());
+
+    // whether doubles were hashed by value
+    fprintf(file, ",%i", hash_exact_doubles ? 1 : 0);
+
+    fprintf(file, "\n");
+    fclose(file);
+}
+
+static void write_profile(bool result_only, const char* name, size_t object_size, int threads) {
+    char filename[128];
+    mkdir("build", 0755);
+    mkdir("build/profiles", 0755);
+    if (threads > 1)
+        snprintf(filename, sizeof(filename), "build/profiles/%s-%i-t%i.raw", name, (int)object_size, threads);
+    else
+        snprintf(filename, sizeof(filename), "build/profiles/%s-%i.raw", name, (int)object_size);
+    int dropped;
+    int count = profiler_write(filename, &dropped);
+    if (count < 0) {
+        fprintf(stderr, "%s: failed to write profile %s\n", name, filename);
+        return;
+    }
+    if (!result_only)
+        printf("%s: profile: %i samples written to %s\n", name, count, filename);
+    if (dropped > 0)
+        fprintf(stderr, "%s: profile: %i samples dropped\n", name, dropped);
+}
+
 static bool go(bool result_only, size_t object_size, size_t binary_size, const char* name) {
 
     // setup
@@ -99,14 +1387,39 @@ static bool go(bool result_only, size_t object_size, size_t binary_size, const c
         printf("%s: ================\n", name);
         printf("%s: setting up size %i\n", name, (int)object_size);
     }
+    clear_inputs();
+    data_size = 0;
+    usage_t setup_usage, end_usage;
+    start_usage(&setup_usage);
     if (!setup_test(object_size)) {
         fprintf(stderr, "%s: failed to get setup result.\n", name);
         return false;
     }
+    get_usage(&end_usage);
+    phase_t setup;
+    get_phase(&setup, &setup_usage, &end_usage);
+    if (!result_only) {
+        if (corpus_size > 1)
+            printf("%s: corpus of %i documents\n", name, corpus_size);
+        for (int i = 0; i < input_count; ++i) {
+            if (inputs[i].copies)
+                printf("%s: cold cache: rotating through %i copies totalling %i KB\n", name,
+                        (int)inputs[i].count, (int)(inputs[i].copies_size / 1024));
+        }
+    }
 
     // if this isn't a benchmark (the file creators), nothing left to do
+    // except write the rest of the corpus
     if (!is_benchmark()) {
         teardown_test();
+        for (corpus_member = 1; corpus_member < corpus_size; ++corpus_member) {
+            if (!setup_test(object_size)) {
+                fprintf(stderr, "%s: failed to get setup result.\n", name);
+                return false;
+            }
+            teardown_test();
+        }
+        corpus_member = 0;
         if (!result_only)
             printf("%s: done\n", name);
         return true;
@@ -119,94 +1432,649 @@ static bool go(bool result_only, size_t object_size, size_t binary_size, const c
     #else
     iterations = 32;
     #endif
-    for (size_t i = 5; i > object_size; --i)
-        iterations <<= 3;
+    if (object_size <= BENCHMARK_SIZE_MAX) {
+        for (size_t i = 5; i > object_size; --i)
+            iterations <<= 3;
+    } else {
+        // about as many bytes between checks as at size 5 (about 1.5 MB)
+        iterations = (int)((iterations * (size_t)1500000) / object_size);
+        if (iterations < 1)
+            iterations = 1;
+    }
+
+    // in adaptive mode we instead calibrate the batch to take about
+    // BATCH_TIME, so that there are enough batches to measure the variance
+    if (!fixed_time && !calibrate_iterations(name, &iterations))
+        return false;
+
+    // evicting takes far longer than the test, so we check the time after
+    // every iteration
+    if (evict_cache)
+        iterations = 1;
+
+    // in a thread sweep we run every thread count from 1 up to the
+    // number of cores, and compare each against the single thread result
+    int min_threads = thread_count;
+    int max_threads = thread_count;
+    if (thread_sweep) {
+        min_threads = 1;
+        max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (max_threads < 1)
+            max_threads = 1;
+    }
+
+    // count allocations outside of the timed loop. this also tells us
+    // whether the test parses a mapped file directly or copies it.
+    bool mapped = map_input && data_size != 0;
+    benchmark_input_copied = false;
+    allocations_t allocations;
+    if (!count_allocations(name, &allocations))
+        return false;
+    bool zero_copy = !benchmark_input_copied;
+    if (mapped && !result_only)
+        printf("%s: mapped input (%s): %s\n", name, input_mode,
+                zero_copy ? "parsing the mapping directly" : "parsing a copy");
+
+    uint32_t corpus_hash = 0;
+    if (corpus_size > 1 && !hash_corpus(name, &corpus_hash))
+        return false;
+
+    // tests without a data file are normalized by the size of their output
+    if (data_size == 0 && !measure_output(name))
+        return false;
+    node_count = 0;
+
+    double single_rate = 0;
+    for (int threads = min_threads; threads <= max_threads; ++threads) {
+        result_t result;
+        double spin = environment_spin();
+        if (!run_threads(result_only, name, threads, iterations, &result))
+            return false;
+        result.spin = spin;
+        result.drift = environment_spin() / spin - 1.0;
+        result.huge_kb = hugepage_resident();
+        if (node_count == 0)
+            count_nodes(object_size);
+        if (threads == 1)
+            single_rate = result.docs_per_second;
+        if (corpus_size > 1)
+            result.hash_result = corpus_hash;
+
+        // print results
+        if (result_only) {
+            printf("%f\n", result.per_time);
+        } else {
+            printf("%s: %i iterations took %f seconds\n", name, result.total_iterations, result.elapsed);
+            printf("%s: %f microseconds per iteration\n", name, result.per_time);
+            if (isfinite(result.ci))
+                printf("%s: 95%% confidence interval +/- %f microseconds (%.2f%%) over %i batches of %i\n",
+                        name, result.ci, 100.0 * result.ci / result.per_time, result.batches, iterations);
+            if (!fixed_time && threads == 1)
+                printf("%s: warmed up for %.2f seconds\n", name, result.warm_time);
+            if (result.latency)
+                print_latency(name, result.latency);
+            print_throughput(name, &result);
+            if (result.has_counters)
+                print_counters(name, &result);
+            if (result.phase_time[0] >= 0)
+                print_phases(name, &result);
+            else if (benchmark_phases)
+                printf("%s: phases: the test doesn't mark its phases\n", name);
+            print_allocations(name, &allocations);
+            print_phase(name, "setup", &setup);
+            print_phase(name, "warm-up", &result.warm);
+            print_phase(name, "work", &result.work);
+            if (threads > 1) {
+                printf("%s: %i threads: %f iterations per second\n", name, threads, result.docs_per_second);
+                if (single_rate > 0)
+                    printf("%s: %i threads: %.1f%% scaling efficiency\n", name, threads,
+                            100.0 * result.docs_per_second / (single_rate * threads));
+            }
+            if (benchmark_huge_pages && result.huge_kb >= 0)
+                printf("%s: huge pages (%s): %li KB backed by huge pages\n", name, huge_mode, result.huge_kb);
+            printf("%s: calibration spin: %.0f microseconds (%+.1f%% from the start of the run), "
+                    "%+.1f%% over the test\n", name, result.spin,
+                    100.0 * (result.spin / reference_spin - 1.0), 100.0 * result.drift);
+            if (corpus_size > 1)
+                printf("%s: hash result of corpus: %08x\n", name, result.hash_result);
+            else
+                printf("%s: hash result of last run: %08x\n", name, result.hash_result);
+        }
+
+        // warn even with -r since the result is suspect
+        if (fabs(result.drift) > DRIFT_TOLERANCE)
+            fprintf(stderr, "%s: warning: the clock speed changed by %+.1f%% during the test. "
+                    "the result may be unreliable.\n", name, -100.0 * result.drift / (1.0 + result.drift));
+
+        if (profile)
+            write_profile(result_only, name, object_size, threads);
+
+        // write score
+        if (!result_only && !profile)
+            write_result(name, object_size, binary_size, &result, &allocations, &setup,
+                    mapped, zero_copy);
+        free(result.latency);
+    }
+
+    teardown_test();
+    clear_inputs();
+
+    return true;
+}
+
+// argument "-r" will print only the per-iteration time result of the test
+static bool result_only = false;
+
+bool benchmark_result_only(void) {
+    return result_only;
+}
+
+bool benchmark_parse_size(const char* arg, size_t* object_size) {
+    char* end;
+    unsigned long long size = strtoull(arg, &end, 10);
+    if (end == arg || size > BENCHMARK_BYTES_MAX)
+        return false;
+    const char* suffix = end;
+    switch (*end) {
+        case 'K': case 'k': size <<= 10; ++end; break;
+        case 'M': case 'm': size <<= 20; ++end; break;
+        case 'G': case 'g': size <<= 30; ++end; break;
+        default: break;
+    }
+    if (*end == 'B' || *end == 'b')
+        ++end;
+    if (*end != '\0' || size < 1 || size > BENCHMARK_BYTES_MAX)
+        return false;
+
+    // a size in bytes that small would be taken as a size class
+    if (end != suffix && size <= BENCHMARK_SIZE_MAX)
+        return false;
+    *object_size = (size_t)size;
+    return true;
+}
+
+int benchmark_parse_option(const char* name, int argc, char** argv) {
+    if (strcmp(argv[0], "-r") == 0) {
+        result_only = true;
+
+    // "-t N" runs the test on N threads concurrently
+    } else if (strcmp(argv[0], "-t") == 0 && argc >= 2) {
+        thread_count = atoi(argv[1]);
+        if (thread_count < 1) {
+            fprintf(stderr, "%s: thread count must be at least 1\n", name);
+            return -1;
+        }
+        return 2;
+
+    // "-T" sweeps the thread count from 1 to the number of cores
+    } else if (strcmp(argv[0], "-T") == 0) {
+        thread_sweep = true;
+
+    // "-l" records a histogram of per-iteration latencies
+    } else if (strcmp(argv[0], "-l") == 0) {
+        record_latency = true;
+
+    // "-x" times every iteration with the TSC
+    } else if (strcmp(argv[0], "-x") == 0) {
+        use_tsc = true;
+        record_latency = true;
+
+    // "-b" times the phases of tree tests separately
+    } else if (strcmp(argv[0], "-b") == 0) {
+        benchmark_phases = true;
+
+    // "-V" hashes the exact values of doubles
+    } else if (strcmp(argv[0], "-V") == 0) {
+        hash_exact_doubles = true;
+
+    // "-c" measures hardware performance counters
+    } else if (strcmp(argv[0], "-c") == 0) {
+        use_counters = true;
+
+    // "-f" always runs the full warm-up and work time
+    } else if (strcmp(argv[0], "-f") == 0) {
+        fixed_time = true;
+
+    // "-m M" cycles through a corpus of M documents
+    } else if (strcmp(argv[0], "-m") == 0 && argc >= 2) {
+        corpus_size = atoi(argv[1]);
+        if (corpus_size < 1) {
+            fprintf(stderr, "%s: corpus size must be at least 1\n", name);
+            return -1;
+        }
+        return 2;
+
+    // "-C" rotates through copies of the input so it isn't in cache
+    } else if (strcmp(argv[0], "-C") == 0) {
+        cold_cache = true;
+        benchmark_direct_input = true;
+
+    // "-E" also evicts the caches between iterations
+    } else if (strcmp(argv[0], "-E") == 0) {
+        cold_cache = true;
+        evict_cache = true;
+        benchmark_direct_input = true;
+
+    // "-M[phs]" maps data files read-only, optionally populated (p) and
+    // advised for huge pages (h) or sequential access (s)
+    } else if (strncmp(argv[0], "-M", 2) == 0) {
+        map_input = true;
+        benchmark_direct_input = true;
+        strcpy(input_mode, "mmap");
+        for (const char* flag = argv[0] + 2; *flag; ++flag) {
+            switch (*flag) {
+                case 'p': map_flags |= MAPFILE_POPULATE; strcat(input_mode, "+populate"); break;
+                case 'h': map_flags |= MAPFILE_HUGEPAGE; strcat(input_mode, "+hugepage"); break;
+                case 's': map_flags |= MAPFILE_SEQUENTIAL; strcat(input_mode, "+sequential"); break;
+                default:
+                    fprintf(stderr, "%s: unknown mapping flag '%c' (expected p, h or s)\n", name, *flag);
+                    return -1;
+            }
+        }
+
+    // "-p CPU" pins the test to a CPU
+    } else if (strcmp(argv[0], "-p") == 0 && argc >= 2) {
+        pin_cpu = atoi(argv[1]);
+        if (pin_cpu < 0 || pin_cpu >= environment_cpu_count()) {
+            fprintf(stderr, "%s: CPU must be in the range [0,%i]\n", name, environment_cpu_count() - 1);
+            return -1;
+        }
+        return 2;
+
+    // "-L" locks memory so it can't be paged out
+    } else if (strcmp(argv[0], "-L") == 0) {
+        lock_memory = true;
+
+    // "-P" runs with realtime priority
+    } else if (strcmp(argv[0], "-P") == 0) {
+        realtime_priority = true;
+
+    // "-S" samples call stacks during the work phase
+    } else if (strcmp(argv[0], "-S") == 0) {
+        profile = true;
 
+    // "-F NAME" pre-fragments the heap with the named profile
+    } else if (strcmp(argv[0], "-F") == 0 && argc >= 2) {
+        size_t i = 0;
+        while (i < HEAP_PROFILE_COUNT && strcmp(argv[1], heap_profiles[i].name) != 0)
+            ++i;
+        if (i == HEAP_PROFILE_COUNT) {
+            fprintf(stderr, "%s: unknown heap profile \"%s\" (expected", name, argv[1]);
+            for (i = 0; i < HEAP_PROFILE_COUNT; ++i)
+                fprintf(stderr, " %s", heap_profiles[i].name);
+            fprintf(stderr, ")\n");
+            return -1;
+        }
+        heap_profile = &heap_profiles[i];
+        return 2;
+
+    // "-G NAME" generates the data with the named workload profile, or
+    // with the profile in the file NAME
+    } else if (strcmp(argv[0], "-G") == 0 && argc >= 2) {
+        size_t i = 0;
+        while (i < GENERATOR_PROFILE_COUNT && strcmp(argv[1], generator_profiles[i].name) != 0)
+            ++i;
+        if (i < GENERATOR_PROFILE_COUNT) {
+            generator_use(&generator_profiles[i]);
+            return 2;
+        }
+        if (!strchr(argv[1], '/') && !strchr(argv[1], '.')) {
+            fprintf(stderr, "%s: unknown workload profile \"%s\" (expected", name, argv[1]);
+            for (i = 0; i < GENERATOR_PROFILE_COUNT; ++i)
+                fprintf(stderr, " %s", generator_profiles[i].name);
+            fprintf(stderr, ", or a profile file)\n");
+            return -1;
+        }
+        if (!generator_profile_load(argv[1], &loaded_profile))
+            return -1;
+        for (i = 0; i < GENERATOR_PROFILE_COUNT; ++i) {
+            if (strcmp(loaded_profile.name, generator_profiles[i].name) == 0) {
+                fprintf(stderr, "%s: profile name \"%s\" is taken by a built-in profile\n", name, loaded_profile.name);
+                return -1;
+            }
+        }
+        generator_use(&loaded_profile);
+        return 2;
+
+    // "-H" backs buffers with transparent huge pages, "-Ht" with hugetlbfs
+    } else if (strcmp(argv[0], "-H") == 0 || strcmp(argv[0], "-Ht") == 0) {
+        benchmark_huge_pages = true;
+        use_hugetlb = argv[0][2] == 't';
+
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+bool benchmark_begin(const char* name) {
+
+    // pin before allocating anything so that memory is local to the CPU
+    if (pin_cpu >= 0 && !environment_pin(pin_cpu))
+        fprintf(stderr, "%s: failed to pin to CPU %i\n", name, pin_cpu);
+    if (realtime_priority && !environment_realtime())
+        fprintf(stderr, "%s: failed to set realtime priority (are you root?)\n", name);
+
+    if (profile && !profiler_init()) {
+        fprintf(stderr, "%s: the sampling profiler is not supported on this platform\n", name);
+        return false;
+    }
+
+    if (map_input) {
+        if (!mapfile_available()) {
+            fprintf(stderr, "%s: mapped input is not supported on this platform\n", name);
+            return false;
+        }
+        mapfile_protect(name);
+    }
+
+    if (benchmark_huge_pages) {
+        bool requested = use_hugetlb;
+        if (!hugepage_init(&use_hugetlb)) {
+            fprintf(stderr, "%s: huge pages are not available (are transparent huge pages disabled?)\n", name);
+            return false;
+        }
+        if (requested && !use_hugetlb)
+            fprintf(stderr, "%s: no free pages in hugetlbfs (see /proc/sys/vm/nr_hugepages); "
+                    "using transparent huge pages\n", name);
+        strcpy(huge_mode, use_hugetlb ? "hugetlb" : "thp");
+
+        // glibc.malloc.hugetlb is 1 for transparent huge pages or 2 for
+        // hugetlbfs; 0 is the default
+        const char* tunables = getenv("GLIBC_TUNABLES");
+        const char* tunable = tunables ? strstr(tunables, "glibc.malloc.hugetlb=") : NULL;
+        if (tunable && tunable[strlen("glibc.malloc.hugetlb=")] != '0')
+            strcat(huge_mode, "+malloc");
+        else if (!result_only)
+            printf("%s: note: library allocations are not on huge pages "
+                    "(set GLIBC_TUNABLES=glibc.malloc.hugetlb=1)\n", name);
+    }
+
+    // the eviction buffer is allocated before the memory baseline
+    if (evict_cache) {
+        evict_size = 2 * cache_size();
+        evict_buffer = (char*)malloc(evict_size);
+        if (!evict_buffer) {
+            fprintf(stderr, "%s: out of memory for eviction buffer\n", name);
+            return false;
+        }
+        memset(evict_buffer, 1, evict_size);
+    }
+
+    if (use_tsc) {
+        if (tsc_available()) {
+            tsc_ticks_per_ns = tsc_calibrate();
+            tsc_overhead_ticks = tsc_overhead();
+            if (!result_only)
+                printf("%s: TSC at %.3f GHz, timer overhead of %i ticks (%.1f ns) subtracted from each iteration\n",
+                        name, tsc_ticks_per_ns, (int)tsc_overhead_ticks, tsc_overhead_ticks / tsc_ticks_per_ns);
+        } else {
+            fprintf(stderr, "%s: no invariant TSC; timing iterations with the monotonic clock\n", name);
+            use_tsc = false;
+        }
+    }
+
+    fragment_memory();
+    if (lock_memory && !environment_lock_memory())
+        fprintf(stderr, "%s: failed to lock memory (check ulimit -l)\n", name);
+    resettable_rss = reset_peak_rss();
+    get_usage(&baseline_usage);
+
+    // record the environment
+    int cpu = pin_cpu >= 0 ? pin_cpu : environment_current_cpu();
+    environment_governor(cpu < 0 ? 0 : cpu, governor, sizeof(governor));
+    smt_state = environment_smt();
+    allocator = alloc_name();
+    reference_spin = environment_spin();
+    if (!result_only) {
+        printf("%s: CPU %i, governor %s, SMT %s, allocator %s, heap profile %s, workload %s\n", name, cpu,
+                governor[0] ? governor : "unknown", smt_state[0] ? smt_state : "unknown", allocator,
+                heap_profile->name, workload_name());
+        if (strcmp(governor, "performance") != 0 && governor[0])
+            printf("%s: note: the CPU frequency governor is not \"performance\"\n", name);
+        if (strcmp(smt_state, "on") == 0)
+            printf("%s: note: SMT is on; a sibling thread may share the core\n", name);
+    }
+    return true;
+}
+
+void benchmark_end(void) {
+    free_fragmented_memory();
+    free(evict_buffer);
+    hugepage_release();
+    profiler_destroy();
+}
+
+#if BENCHMARK_RUNNER
+bool benchmark_run(const benchmark_plugin_t* test_plugin, const char* name,
+        size_t binary_size, size_t object_size)
+{
+    plugin = test_plugin;
+    return go(result_only, object_size, binary_size, name);
+}
+
+// In comparison mode the two variants run in alternating batches, ABBA
+// so that neither always runs first, and each pair of batches gives the
+// ratio of B's time per iteration to A's. Conditions that drift over the
+// run (clock frequency, temperature, other load) affect both batches of a
+// pair almost equally, so the ratios are far less noisy than the times.
+// We report the geometric mean of the ratios with a bootstrap confidence
+// interval, and the p-value of a Wilcoxon signed-rank test of the log
+// ratios. The work phase ends once the interval is narrow enough, or after
+// the work time of both variants.
+#define COMPARE_MIN_PAIRS 30
+#define COMPARE_TARGET 0.002     // half-width of the confidence interval of the log ratio
+#define COMPARE_RESAMPLES 2000
+#define COMPARE_SIGNIFICANCE 0.05
+
+typedef struct variant_t {
+    const benchmark_plugin_t* plugin;
+    const char* name;
+    int iterations;
     uint32_t hash_result;
+    stats_t times; // time per iteration of each work batch, in microseconds
+    double batches[STEADY_BATCHES];
+    int batch_count;
+} variant_t;
 
-    // warm up
+// Sets up the variant, or returns false with nothing set up.
+static bool setup_variant(variant_t* variant, size_t object_size) {
+    plugin = variant->plugin;
+    if (!setup_test(object_size)) {
+        fprintf(stderr, "%s: failed to get setup result.\n", variant->name);
+        return false;
+    }
+    if (!calibrate_iterations(variant->name, &variant->iterations)) {
+        teardown_test();
+        return false;
+    }
+    return true;
+}
+
+// Tears down the first count variants, i.e. those that were set up.
+static void teardown_variants(variant_t* variants, int count) {
+    for (int i = 0; i < count; ++i) {
+        plugin = variants[i].plugin;
+        teardown_test();
+    }
+    clear_inputs();
+}
+
+// Runs a batch of the variant and returns its time per iteration in
+// microseconds, or a negative value on failure.
+static double run_batch(variant_t* variant) {
+    plugin = variant->plugin;
+    double start_time = dtime();
+    for (int i = 0; i < variant->iterations; ++i) {
+        variant->hash_result = HASH_INITIAL_VALUE;
+        if (!run_wrapper(&variant->hash_result)) {
+            fprintf(stderr, "%s: failed to get benchmark result.\n", variant->name);
+            return -1;
+        }
+    }
+    double time = (dtime() - start_time) / variant->iterations * (1000.0 * 1000.0);
+    variant->batches[variant->batch_count++ % STEADY_BATCHES] = time;
+    return time;
+}
+
+bool benchmark_compare(const benchmark_plugin_t* plugin_a, const char* name_a,
+        const benchmark_plugin_t* plugin_b, const char* name_b, size_t object_size)
+{
+    char name[160];
+    snprintf(name, sizeof(name), "%s vs %s", name_a, name_b);
+    if (thread_count != 1 || thread_sweep || corpus_size != 1 || evict_cache) {
+        fprintf(stderr, "%s: comparisons run on a single thread, without -m or -E\n", name);
+        return false;
+    }
+
+    // setup
+    if (!result_only) {
+        printf("%s: ================\n", name);
+        printf("%s: setting up size %i\n", name, (int)object_size);
+    }
+    clear_inputs();
+    data_size = 0;
+    variant_t variants[2];
+    memset(variants, 0, sizeof(variants));
+    variants[0].plugin = plugin_a;
+    variants[0].name = name_a;
+    variants[1].plugin = plugin_b;
+    variants[1].name = name_b;
+    for (int i = 0; i < 2; ++i) {
+        if (!setup_variant(&variants[i], object_size)) {
+            teardown_variants(variants, i);
+            return false;
+        }
+    }
+
+    // warm up until both are steady
     if (!result_only)
-        printf("%s: warming for %.0f seconds \n", name, WARM_TIME);
+        printf("%s: warming until steady for up to %.0f seconds\n", name, 2 * WARM_TIME);
     double start_time = dtime();
     while (true) {
-        for (int i = 0; i < iterations; ++i) {
-            hash_result = 0;
-            if (!run_wrapper(&hash_result)) {
-                fprintf(stderr, "%s: failed to get benchmark result.\n", name);
-                return false;
-            }
+        bool failed = false;
+        for (int i = 0; i < 2 && !failed; ++i)
+            failed = run_batch(&variants[i]) < 0;
+        if (failed) {
+            teardown_variants(variants, 2);
+            return false;
         }
-        if (dtime() - start_time > WARM_TIME)
+        double elapsed = dtime() - start_time;
+        if (elapsed > 2 * WARM_TIME)
+            break;
+        if (!fixed_time && elapsed > MIN_WARM_TIME &&
+                is_steady(variants[0].batches, variants[0].batch_count) &&
+                is_steady(variants[1].batches, variants[1].batch_count))
             break;
     }
 
-    // run tests
+    // run pairs of batches
     if (!result_only)
-        printf("%s: running for %.0f seconds\n", name, WORK_TIME);
-    int total_iterations = 0;
+        printf("%s: running pairs until the ratio is within %.1f%% for up to %.0f seconds\n",
+                name, COMPARE_TARGET * 100.0, 2 * WORK_TIME);
+    int capacity = 256;
+    int pairs = 0;
+    double* log_ratios = (double*)malloc(capacity * sizeof(double));
+    stats_t log_stats;
+    stats_clear(&log_stats);
+    stats_clear(&variants[0].times);
+    stats_clear(&variants[1].times);
     start_time = dtime();
-    double end_time;
+    double elapsed;
     while (true) {
-        for (int i = 0; i < iterations; ++i) {
-            hash_result = HASH_INITIAL_VALUE;
-            if (!run_wrapper(&hash_result)) {
-                fprintf(stderr, "%s: failed to get benchmark result.\n", name);
+        if (pairs == capacity) {
+            capacity *= 2;
+            log_ratios = (double*)realloc(log_ratios, capacity * sizeof(double));
+        }
+        if (!log_ratios) {
+            fprintf(stderr, "%s: out of memory\n", name);
+            teardown_variants(variants, 2);
+            return false;
+        }
+
+        double times[2];
+        for (int i = 0; i < 2; ++i) {
+            int variant = (pairs % 2 == 0) ? i : 1 - i;
+            times[variant] = run_batch(&variants[variant]);
+            if (times[variant] < 0) {
+                free(log_ratios);
+                teardown_variants(variants, 2);
                 return false;
             }
-            ++total_iterations;
         }
-        end_time = dtime();
-        if (end_time - start_time > WORK_TIME)
+        stats_add(&variants[0].times, times[0]);
+        stats_add(&variants[1].times, times[1]);
+        log_ratios[pairs++] = log(times[1] / times[0]);
+        stats_add(&log_stats, log_ratios[pairs - 1]);
+
+        elapsed = dtime() - start_time;
+        if (elapsed > 2 * WORK_TIME)
+            break;
+        if (!fixed_time && elapsed > 2 * MIN_WORK_TIME && pairs >= COMPARE_MIN_PAIRS &&
+                stats_ci(&log_stats) <= COMPARE_TARGET)
             break;
     }
 
-    // print results
-    double per_time = (end_time - start_time) / (double)total_iterations * (1000.0 * 1000.0);
-    if (result_only) {
-        printf("%f\n", per_time);
-    } else {
-        printf("%s: %i iterations took %f seconds\n", name, total_iterations, end_time - start_time);
-        printf("%s: %f microseconds per iteration\n", name, per_time);
-        printf("%s: hash result of last run: %08x\n", name, hash_result);
+    double low, high;
+    bool ok = stats_bootstrap_ci(log_ratios, pairs, COMPARE_RESAMPLES, &low, &high);
+    double p_value = stats_wilcoxon(log_ratios, pairs);
+    free(log_ratios);
+    if (!ok) {
+        fprintf(stderr, "%s: out of memory\n", name);
+        teardown_variants(variants, 2);
+        return false;
     }
 
-    // write score
-    if (!result_only) {
-        FILE* file = fopen("results.csv", "a");
-        fprintf(file, "\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",%i,%f,%i,%i,\"%08x\"\n",
-                name, test_language(), test_version(), test_filename(), test_format(),
-                (int)object_size, per_time, (int)binary_size,
-                #if BENCHMARK_SIZE_OPTIMIZED
-                1,
-                #else
-                0,
-                #endif
-                hash_result);
-        fclose(file);
+    // the variants must do the same work for the comparison to mean anything
+    if (variants[0].hash_result != variants[1].hash_result) {
+        fprintf(stderr, "%s: the variants got different hash results: %08x and %08x\n",
+                name, variants[0].hash_result, variants[1].hash_result);
+        teardown_variants(variants, 2);
+        return false;
     }
+    double difference = 100.0 * (exp(log_stats.mean) - 1.0);
+    low = 100.0 * (exp(low) - 1.0);
+    high = 100.0 * (exp(high) - 1.0);
+    bool significant = p_value < COMPARE_SIGNIFICANCE && (low > 0 || high < 0);
 
-    teardown_test();
+    // print results
+    if (result_only) {
+        printf("%f\n", difference);
+    } else {
+        printf("%s: %i pairs of batches took %f seconds\n", name, pairs, elapsed);
+        for (int i = 0; i < 2; ++i)
+            printf("%s: %s: %f microseconds per iteration, hash result of last run: %08x\n", name,
+                    variants[i].name, variants[i].times.mean, variants[i].hash_result);
+        printf("%s: %s is %+.2f%% relative to %s, 95%% confidence interval [%+.2f%%, %+.2f%%]\n",
+                name, name_b, difference, name_a, low, high);
+        printf("%s: Wilcoxon signed-rank p = %.4f: %s\n", name, p_value,
+                significant ? "significant" : "not significant");
+    }
 
+    teardown_variants(variants, 2);
     return true;
 }
-
+#else
 int main(int argc, char **argv) {
     const char* name = argv[0];
     ++argv;
     --argc;
 
-    // argument "-r" will print only the per-iteration time result of the test
-    bool result_only = false;
-    if (argc >= 1 && strcmp(argv[0], "-r") == 0) {
-        result_only = true;
-        ++argv;
-        --argc;
+    // options must come before the sizes
+    while (argc >= 1 && argv[0][0] == '-') {
+        int count = benchmark_parse_option(name, argc, argv);
+        if (count == 0)
+            fprintf(stderr, "%s: unrecognized option %s\n", name, argv[0]);
+        if (count <= 0)
+            return EXIT_FAILURE;
+        argv += count;
+        argc -= count;
     }
 
     // need sizes
     if (argc == 0) {
-        fprintf(stderr, "%s: object sizes in the range [1,5] must be "
-                "provided as command-line arguments\n", name);
+        fprintf(stderr, "%s: object sizes in the range [1,5] (or target sizes "
+                "in bytes) must be provided as command-line arguments\n", name);
         return EXIT_FAILURE;
     }
 
@@ -227,23 +2095,33 @@ int main(int argc, char **argv) {
         printf("%s: executable size: %i bytes\n",     name, (int)binary_size);
 
     // run different benchmark sizes
-    fragment_memory();
+    if (!benchmark_begin(name))
+        return EXIT_FAILURE;
     for (; argc > 0; --argc, ++argv) {
 
-        size_t object_size = atoi(argv[0]);
-        if (object_size < 1 || object_size > 5) {
-            fprintf(stderr, "%s: object size must be in the range [1,5]\n", name);
+        size_t object_size;
+        if (!benchmark_parse_size(argv[0], &object_size)) {
+            fprintf(stderr, "%s: object size must be in the range [1,5], or a target size "
+                    "in bytes up to 1G (e.g. 700 or 64K)\n", name);
             return EXIT_FAILURE;
         }
 
         if (!go(result_only, object_size, (int)st.st_size, name))
             return EXIT_FAILURE;
     }
-    free_fragmented_memory();
+    benchmark_end();
     return EXIT_SUCCESS;
 }
+#endif
 
 static char* load_file(const char* filename, size_t* size_out) {
+    if (map_input) {
+        char* data = mapfile_open(filename, size_out, map_flags);
+        if (!data)
+            fprintf(stderr, "missing file!\n");
+        return data;
+    }
+
     FILE* file = fopen(filename, "rb");
     if (!file) {
         fprintf(stderr, "missing file!\n");
@@ -253,10 +2131,17 @@ static char* load_file(const char* filename, size_t* size_out) {
     fseek(file, 0, SEEK_END);
     long size = ftell(file);
     fseek(file, 0, SEEK_SET);
-    char* data = (char*)malloc(size);
+    char* data = (char*)benchmark_buffer_alloc(size);
+    if (!data) {
+        fprintf(stderr, "out of memory loading file!\n");
+        fclose(file);
+        return NULL;
+    }
 
     if (size != fread(data, 1, size, file)) {
         fprintf(stderr, "error reading file!\n");
+        benchmark_buffer_free(data);
+        fclose(file);
         return NULL;
     }
     fclose(file);
@@ -265,6 +2150,11 @@ static char* load_file(const char* filename, size_t* size_out) {
     return data;
 }
 
+void free_data_file(char* data) {
+    if (!mapfile_close(data))
+        benchmark_buffer_free(data);
+}
+
 char* load_data_file(const char* format, size_t object_size, size_t* size_out) {
     return load_data_file_ex(format, object_size, size_out, NULL);
 }
@@ -272,6 +2162,16 @@ char* load_data_file(const char* format, size_t object_size, size_t* size_out) {
 char* load_data_file_ex(const char* format, size_t object_size, size_t* size_out, const char* config) {
     char filename[64];
     benchmark_filename(filename, sizeof(filename), object_size, format, config);
-    return load_file(filename, size_out);
+    char* data = load_file(filename, size_out);
+    if (data) {
+        data_size = *size_out;
+        if ((corpus_size > 1 || cold_cache || map_input) &&
+                !register_input(data, *size_out, format, object_size, config))
+        {
+            free_data_file(data);
+            return NULL;
+        }
+    }
+    return data;
 }
 
@@ -27,6 +27,8 @@
 #include "platform.h"
 #include "generator.h"
 #include "hash.h"
+#include "hugepage.h"
+#include "alloc.h"
 
 #define BENCHMARK_FORMAT_MESSAGEPACK "mp"
 #define BENCHMARK_FORMAT_JSON        "json"
@@ -38,6 +40,11 @@
 #define BENCHMARK_LANGUAGE_CXX "C++"
 
 #define BENCHMARK_NODE_MAX         (32*4096) /* upper bound */
+
+// Object sizes up to this are size classes; larger sizes are a target
+// encoded size in bytes (see object_create_sized().)
+#define BENCHMARK_SIZE_MAX 5
+#define BENCHMARK_BYTES_MAX ((size_t)1 << 30)
 #define BENCHMARK_VERSION 0.1
 
 #define BENCHMARK_STRINGIFY2(x) #x
@@ -50,6 +57,10 @@
 // the actual in-situ parsing is enabled by BENCHMARK_IN_SITU in the Makefile.
 #define BENCHMARK_MAKE_IN_SITU_COPIES 1
 
+#ifndef BENCHMARK_IN_SITU
+#define BENCHMARK_IN_SITU 0
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -72,29 +83,119 @@ const char* test_version(void);
 const char* test_format(void);
 const char* test_filename(void);
 
-// Loads a data file. Should be freed with free().
+// Loads a data file. Should be freed with free_data_file().
 char* load_data_file(const char* format, size_t object_size, size_t* size_out);
 
-// Loads a special data file. Should be freed with free().
+// Loads a special data file. Should be freed with free_data_file().
 char* load_data_file_ex(const char* format, size_t object_size, size_t* size_out, const char* config);
 
+// Frees a data file loaded by load_data_file(). In mapped input mode (-M)
+// the file is mapped rather than read, so it must not be freed with free().
+void free_data_file(char* data);
+
 // Generates a random object for benchmarking.
 object_t* benchmark_object_create(size_t object_size);
 
 // Generates the filename for a data file
 void benchmark_filename(char* buf, size_t size, size_t object_size, const char* format, const char* config);
 
+// Returns the object to write or hash on this iteration. This is normally
+// the root object itself, but in corpus mode (-m) it's the next document of
+// the corpus. Write tests must call this on every iteration.
+object_t* benchmark_object(object_t* root);
+
+// The size of the data written by the last iteration of a write test on
+// this thread
+extern __thread size_t benchmark_output;
+
+// Records the size of the data written by a write test, so that results can
+// be normalized by the size of the encoded data (as read tests are by the
+// size of their data file.) Write tests must call this on every iteration.
+static inline void benchmark_output_size(size_t size) {
+    benchmark_output = size;
+}
+
+// Returns the data to parse on this iteration and updates its size. This is
+// normally the data loaded by load_data_file() itself, but in corpus mode
+// it's the next document of the corpus, and in cold cache mode (-C) it's the
+// next of several copies spread over more memory than the last level cache.
+char* benchmark_input(char* source, size_t* size);
+
+// Whether parsers that don't modify their input should parse the data
+// directly rather than a copy of it: in cold cache mode (-C) and mapped
+// input mode (-M)
+extern bool benchmark_direct_input;
+
+// Whether the test parsed a copy of its input in spite of the above. This
+// is per thread; the harness reads the main thread's after counting
+// allocations.
+extern __thread bool benchmark_input_copied;
+
+// The data last returned by benchmark_input() on this thread if it's one
+// of the cold copies or a mapped file, or NULL. This spares the hot path
+// from searching the inputs and mappings for the data.
+extern __thread char* benchmark_direct_data;
+
+// The size of the last in-situ copy made on the heap by this thread, and
+// the size the allocation tracker counts for it, so that it can be left
+// out of the test's peak heap usage
+extern __thread size_t benchmark_in_situ_size;
+extern __thread size_t benchmark_in_situ_usable;
+
+
+// Whether input copies and output buffers are backed by huge pages (-H)
+extern bool benchmark_huge_pages;
+
+// Allocates an input or output buffer. These are normally on the heap, but
+// in huge page mode (-H) they're on huge pages. Tests that manage their own
+// buffers (e.g. buffer_t) should allocate them with these. Returns NULL if
+// out of memory, which with huge pages can happen well before the heap is.
+static inline void* benchmark_buffer_alloc(size_t size) {
+    if (benchmark_huge_pages)
+        return hugepage_alloc(size);
+    return malloc(size);
+}
+
+static inline void* benchmark_buffer_realloc(void* data, size_t size) {
+    if (benchmark_huge_pages)
+        return hugepage_realloc(data, size);
+    return realloc(data, size);
+}
+
+static inline void benchmark_buffer_free(void* data) {
+    if (benchmark_huge_pages && hugepage_free(data))
+        return;
+    free(data);
+}
+
 // Copies a data buffer if in-situ parsing is enabled. All
-// parsing tests must call this on every iteration.
-static inline char* benchmark_in_situ_copy(char* source, size_t size) {
+// parsing tests must call this on every iteration, and must parse
+// the returned data with the size it returns.
+static inline char* benchmark_in_situ_copy(char* source, size_t* size) {
+    source = benchmark_input(source, size);
+
+    #if !BENCHMARK_IN_SITU
+    // copying the data would bring it into cache, so in cold cache mode
+    // parsers that don't modify their input parse the cold copy directly;
+    // in mapped input mode they parse the read-only mapping
+    if (source == benchmark_direct_data)
+        return source;
+    #endif
+
     #if BENCHMARK_MAKE_IN_SITU_COPIES
-    char* data = (char*)malloc(size + 1);
+    if (benchmark_direct_input)
+        benchmark_input_copied = true;
+    char* data = (char*)benchmark_buffer_alloc(*size + 1);
     if (!data)
         return NULL;
-    memcpy(data, source, size);
+    if (!benchmark_huge_pages) {
+        benchmark_in_situ_size = *size + 1;
+        benchmark_in_situ_usable = alloc_block_size(data, *size + 1);
+    }
+    memcpy(data, source, *size);
     // some APIs (e.g. yajl, or RapidJSON with in-situ mode) require the
     // entire document to be null-terminated
-    data[size] = '\0';
+    data[*size] = '\0';
     return data;
     #else
     return source;
@@ -103,11 +204,41 @@ static inline char* benchmark_in_situ_copy(char* source, size_t size) {
 
 // Frees a data buffer if in-situ parsing is enabled
 static inline void benchmark_in_situ_free(char* data) {
+    if (data == benchmark_direct_data)
+        return;
     #if BENCHMARK_MAKE_IN_SITU_COPIES
-    free(data);
+    benchmark_buffer_free(data);
     #endif
 }
 
+// The phases of a tree test, timed separately in phase mode (-b)
+typedef enum benchmark_phase_t {
+    benchmark_phase_parse,    // building the tree
+    benchmark_phase_traverse, // walking it to hash it
+    benchmark_phase_free,     // destroying it
+    BENCHMARK_PHASE_COUNT
+} benchmark_phase_t;
+
+// Whether phases are timed (-b)
+extern bool benchmark_phases;
+
+// Ends the current phase, if any, and begins the given one, or none if
+// it's BENCHMARK_PHASE_COUNT. Use the functions below instead.
+void benchmark_phase_mark(benchmark_phase_t phase);
+
+// Tree tests call these in run_test() to mark where each phase begins and
+// where the last one ends. Time outside the phases (e.g. in-situ copies)
+// counts towards none of them. Outside phase mode these cost a branch.
+static inline void benchmark_phase_begin(benchmark_phase_t phase) {
+    if (benchmark_phases)
+        benchmark_phase_mark(phase);
+}
+
+static inline void benchmark_phase_end(void) {
+    if (benchmark_phases)
+        benchmark_phase_mark(BENCHMARK_PHASE_COUNT);
+}
+
 #ifdef __cplusplus
 }
 #endif
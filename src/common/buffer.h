@@ -23,7 +23,10 @@
 #define BENCHMARK_BUFFER_H 1
 
 // some libraries don't have support for writing to a growable
-// buffer (e.g. cmp or ubj) so we implement one here.
+// buffer (e.g. cmp or ubj) so we implement one here. it's allocated
+// with benchmark_buffer_alloc() so that it's on huge pages with -H.
+
+#include "benchmark.h"
 
 typedef struct buffer_t {
     char* data;
@@ -31,14 +34,17 @@ typedef struct buffer_t {
     size_t capacity;
 } buffer_t;
 
-static void buffer_init(buffer_t* buffer) {
+// returns false if out of memory (huge pages may run out long before
+// the heap does)
+static bool buffer_init(buffer_t* buffer) {
     buffer->count = 0;
     buffer->capacity = 4096;
-    buffer->data = (char*)malloc(buffer->capacity);
+    buffer->data = (char*)benchmark_buffer_alloc(buffer->capacity);
+    return buffer->data != NULL;
 }
 
 static void buffer_destroy(buffer_t* buffer) {
-    free(buffer->data);
+    benchmark_buffer_free(buffer->data);
 }
 
 static bool buffer_write(buffer_t* buffer, const char* data, size_t count) {
@@ -46,7 +52,7 @@ static bool buffer_write(buffer_t* buffer, const char* data, size_t count) {
         size_t new_capacity = buffer->capacity * 2;
         while (buffer->count + count > new_capacity)
             new_capacity *= 2;
-        char* new_data = (char*)realloc(buffer->data, new_capacity);
+        char* new_data = (char*)benchmark_buffer_realloc(buffer->data, new_capacity);
         if (!new_data)
             return false;
         buffer->data = new_data;
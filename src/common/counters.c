@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// perf_event_open() has no wrapper so we need syscall()
+#define _GNU_SOURCE 1
+
+#include "counters.h"
+
+static const char* names[COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "branch-misses",
+    "L1D-misses",
+    "LLC-misses",
+    "dTLB-misses",
+};
+
+const char* counter_name(counter_t counter) {
+    return names[counter];
+}
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static uint64_t cache_config(uint64_t cache) {
+    return cache |
+        ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static int open_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool counters_open(counters_t* counters) {
+    counters->fds[counter_cycles] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->fds[counter_instructions] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fds[counter_branch_misses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    counters->fds[counter_l1d_misses] = open_counter(PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_L1D));
+    counters->fds[counter_llc_misses] = open_counter(PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_LL));
+    counters->fds[counter_dtlb_misses] = open_counter(PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_DTLB));
+
+    bool any = false;
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        counters->valid[i] = false;
+        counters->values[i] = 0;
+        if (counters->fds[i] >= 0)
+            any = true;
+    }
+    return any;
+}
+
+void counters_close(counters_t* counters) {
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+        if (counters->fds[i] >= 0)
+            close(counters->fds[i]);
+}
+
+void counters_start(counters_t* counters) {
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void counters_stop(counters_t* counters) {
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+        if (counters->fds[i] >= 0)
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        counters->valid[i] = false;
+        if (counters->fds[i] < 0)
+            continue;
+
+        // value, time enabled, time running
+        uint64_t data[3];
+        if (read(counters->fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+            continue;
+        counters->values[i] = (double)data[0];
+        if (data[2] < data[1])
+            counters->values[i] *= (double)data[1] / (double)data[2];
+        counters->valid[i] = true;
+    }
+}
+
+#else
+
+bool counters_open(counters_t* counters) {
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        counters->fds[i] = -1;
+        counters->valid[i] = false;
+    }
+    return false;
+}
+
+void counters_close(counters_t* counters) {}
+void counters_start(counters_t* counters) {}
+void counters_stop(counters_t* counters) {}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_COUNTERS_H
+#define BENCHMARK_COUNTERS_H 1
+
+// Hardware performance counters, measured with perf_event_open() on Linux.
+// Counters are often unavailable (in containers, under a restrictive
+// perf_event_paranoid setting, or in virtual machines that don't expose
+// the PMU), so each counter is opened independently and any that fail to
+// open are simply not reported.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum counter_t {
+    counter_cycles,
+    counter_instructions,
+    counter_branch_misses,
+    counter_l1d_misses,
+    counter_llc_misses,
+    counter_dtlb_misses,
+    COUNTER_COUNT
+} counter_t;
+
+typedef struct counters_t {
+    int fds[COUNTER_COUNT];
+    bool valid[COUNTER_COUNT];
+    double values[COUNTER_COUNT];
+} counters_t;
+
+// Opens all counters for the calling thread and any threads it creates
+// afterwards. Returns false if no counters could be opened.
+bool counters_open(counters_t* counters);
+
+void counters_close(counters_t* counters);
+
+// Resets and enables the counters.
+void counters_start(counters_t* counters);
+
+// Disables the counters and reads their values (scaled to account for
+// multiplexing if the PMU couldn't schedule them all at once.)
+void counters_stop(counters_t* counters);
+
+// Gets a short name for the counter suitable for printing.
+const char* counter_name(counter_t counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
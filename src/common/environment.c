@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// sched_setaffinity() and sched_getcpu() are GNU extensions
+#define _GNU_SOURCE 1
+
+#include "environment.h"
+
+#include <unistd.h>
+
+#define SPIN_ITERATIONS (1 << 22)
+#define SPIN_REPEATS 3
+
+static volatile uint64_t spin_sink;
+
+double environment_spin(void) {
+    double best = 0;
+    for (int repeat = 0; repeat < SPIN_REPEATS; ++repeat) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        // each step depends on the last so this is limited by the latency
+        // of multiply-add, not by how many the core can issue at once
+        uint64_t x = spin_sink | 1;
+        for (int i = 0; i < SPIN_ITERATIONS; ++i)
+            x = x * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+        spin_sink = x;
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double time = (double)(end.tv_sec - start.tv_sec) * (1000.0 * 1000.0) +
+            (double)(end.tv_nsec - start.tv_nsec) / 1000.0;
+        if (repeat == 0 || time < best)
+            best = time;
+    }
+    return best;
+}
+
+int environment_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count < 1 ? 1 : (int)count;
+}
+
+#ifdef __linux__
+
+#include <sched.h>
+#include <sys/mman.h>
+
+bool environment_pin(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool environment_lock_memory(void) {
+    return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+}
+
+bool environment_realtime(void) {
+    // one below the maximum so that the kernel's own realtime threads
+    // (e.g. migration and watchdogs) can still run
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    return sched_setscheduler(0, SCHED_FIFO, &param) == 0;
+}
+
+// Reads the first line of a small sysfs file, without the newline.
+static bool read_line(const char* filename, char* buf, size_t size) {
+    FILE* file = fopen(filename, "r");
+    if (!file)
+        return false;
+    bool ok = fgets(buf, (int)size, file) != NULL;
+    fclose(file);
+    if (!ok)
+        return false;
+    buf[strcspn(buf, "\n")] = '\0';
+    return true;
+}
+
+void environment_governor(int cpu, char* buf, size_t size) {
+    char filename[96];
+    snprintf(filename, sizeof(filename), "/sys/devices/system/cpu/cpu%i/cpufreq/scaling_governor", cpu);
+    if (size > 0 && !read_line(filename, buf, size))
+        buf[0] = '\0';
+}
+
+const char* environment_smt(void) {
+    char active[8];
+    if (!read_line("/sys/devices/system/cpu/smt/active", active, sizeof(active)))
+        return "";
+    return strcmp(active, "1") == 0 ? "on" : "off";
+}
+
+int environment_current_cpu(void) {
+    return sched_getcpu();
+}
+
+#else
+
+bool environment_pin(int cpu) {return false;}
+bool environment_lock_memory(void) {return false;}
+bool environment_realtime(void) {return false;}
+
+void environment_governor(int cpu, char* buf, size_t size) {
+    if (size > 0)
+        buf[0] = '\0';
+}
+
+const char* environment_smt(void) {return "";}
+int environment_current_cpu(void) {return -1;}
+
+#endif
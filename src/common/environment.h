@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_ENVIRONMENT_H
+#define BENCHMARK_ENVIRONMENT_H 1
+
+// Control over and diagnostics of the environment the benchmarks run in:
+// CPU pinning, memory locking, realtime scheduling, and a calibration spin
+// loop to detect changes in clock speed. Most of this is only available on
+// Linux, and often needs privileges, so failures are reported but not fatal.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the number of online CPUs.
+int environment_cpu_count(void);
+
+// Pins the calling thread to the given CPU. Threads created afterwards
+// inherit its affinity.
+bool environment_pin(int cpu);
+
+// Locks all current and future memory of the process so it can't be
+// paged out.
+bool environment_lock_memory(void);
+
+// Switches the calling thread (and threads created afterwards) to realtime
+// FIFO scheduling, so that it isn't preempted by normal processes.
+bool environment_realtime(void);
+
+// Gets the CPU frequency governor of the given CPU (e.g. "performance" or
+// "powersave"), or an empty string if it isn't known.
+void environment_governor(int cpu, char* buf, size_t size);
+
+// Returns "on" or "off" for whether simultaneous multithreading is active,
+// or an empty string if it isn't known.
+const char* environment_smt(void);
+
+// Returns the CPU the calling thread is running on, or -1 if unknown.
+int environment_current_cpu(void);
+
+// Runs a fixed, dependent chain of integer arithmetic a few times and
+// returns the fastest time in microseconds. The loop doesn't touch memory,
+// so its time depends only on the clock speed of the core; comparing it
+// before and after a test detects frequency scaling, turbo and thermal
+// throttling during the test.
+double environment_spin(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,6 +21,11 @@
 
 #include "generator.h"
 
+#include <stddef.h>
+#include <math.h>
+
+#define GENERATOR_STRINGIFY2(x) #x
+#define GENERATOR_STRINGIFY(x) GENERATOR_STRINGIFY2(x)
 
 
 uint32_t random_next(random_t* random) {
@@ -58,12 +63,391 @@ uint32_t random_inverse(random_t* random, uint32_t max) {
 
 
 
+// Workload profiles. Fields that are left out are 0 (or false), which
+// turns most features off.
+
+const generator_profile_t generator_profiles[GENERATOR_PROFILE_COUNT] = {
+    // the original distribution: nested maps and arrays with odds tied to
+    // depth. 1 in 64 scalars are doubles; of the rest, 1/2 are integers,
+    // 1/4 are strings of up to 1000 bytes, 1/8 are nil and 1/8 are bools.
+    // keys are random lowercase strings of 2 to 10 letters.
+    {
+        .name = "default",
+        .max_depth = 31, .nesting = 2, .maps = 1, .arrays = 1, .fanout = 3, .growth = 2,
+        .doubles = 64, .scalars = "nbsuiiis",
+        .string_max = 1000, .nonascii = 4, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 2, .key_max = 10,
+        .int_max = 0xfffff, .wide = true, .negative = true,
+        .double_max = 1024,
+    },
+    // metrics reported by devices: a shallow map of series of samples,
+    // mostly numbers, with short strings and a small set of keys
+    {
+        .name = "telemetry",
+        .max_depth = 2, .nesting = 2, .maps = 1, .arrays = 3, .fanout = 16, .growth = 2,
+        .doubles = 2, .scalars = "iiiuubs",
+        .string_max = 16, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 3, .key_max = 12, .keys = 32,
+        .int_max = 1000000,
+        .double_max = 1000,
+    },
+    // a REST API response: records of mostly strings and ids, with keys
+    // from a small vocabulary and the odd null
+    {
+        .name = "rest",
+        .max_depth = 5, .nesting = 2, .maps = 3, .arrays = 1, .fanout = 4, .growth = 2,
+        .doubles = 32, .scalars = "nbbsssiiu",
+        .string_max = 200, .nonascii = 8, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 2, .key_max = 16, .keys = 64,
+        .int_max = 1000000, .wide = true,
+        .double_max = 1000,
+    },
+    // structured log lines: flat maps of messages and small fields
+    {
+        .name = "log",
+        .max_depth = 3, .nesting = 4, .maps = 4, .arrays = 1, .fanout = 6, .growth = 2,
+        .doubles = 16, .scalars = "sssiiub",
+        .string_max = 400, .nonascii = 16, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 2, .key_max = 12, .keys = 24,
+        .int_max = 65535,
+        .double_max = 1000,
+    },
+    // a configuration blob: deeply nested maps of flags, names and
+    // small numbers, with keys from a large vocabulary
+    {
+        .name = "config",
+        .max_depth = 8, .nesting = 2, .maps = 6, .arrays = 1, .fanout = 4, .growth = 2,
+        .doubles = 64, .scalars = "bbbssssiiu",
+        .string_max = 64, .nonascii = 32, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 3, .key_max = 16, .keys = 128,
+        .int_max = 65536,
+        .double_max = 100,
+    },
+    // an array of homogeneous records, e.g. rows of a query result: every
+    // record has the same keys in the same order, some of them optional
+    {
+        .name = "records",
+        .max_depth = 31, .nesting = 2, .maps = 1, .arrays = 1, .fanout = 2, .growth = 5,
+        .doubles = 16, .scalars = "niiusssssbb",
+        .string_max = 40, .nonascii = 16, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 3, .key_max = 14, .keys = 64,
+        .int_max = 1000000,
+        .double_max = 1000,
+        .schema = 12, .optional = 4,
+    },
+    // a metrics pipeline: large series of full precision doubles or int64
+    // millisecond timestamps, each series all one or the other
+    {
+        .name = "timeseries",
+        .max_depth = 2, .nesting = 1, .maps = 1, .arrays = 1, .fanout = 16, .growth = 2,
+        .scalars = "di", .homogeneous = true,
+        .string_max = 16, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 4, .key_max = 16, .keys = 64,
+        .int_max = 86400000, .int_base = UINT64_C(1700000000000),
+        .double_max = 1000000,
+    },
+    // chat messages in many languages: long strings of CJK text and emoji,
+    // escapes and control characters, mixed with long runs of ASCII
+    {
+        .name = "chat",
+        .max_depth = 3, .nesting = 2, .maps = 1, .arrays = 1, .fanout = 4, .growth = 2,
+        .scalars = "sssssiub",
+        .string_min = 16, .string_max = 2000, .nonascii = 1, .escapes = 16, .controls = true,
+        .unicode = "lcccccceee", .density = 1, .ascii_run = 64,
+        .key_min = 3, .key_max = 12, .keys = 32,
+        .int_max = 1000000,
+        .double_max = 1000,
+    },
+    // every type: floats, binary blobs and extensions (some of them
+    // MessagePack timestamps), unsigned integers up to UINT64_MAX, and the
+    // odd NaN or infinity, for formats that support them (see
+    // generator_support())
+    {
+        .name = "types",
+        .max_depth = 4, .nesting = 2, .maps = 1, .arrays = 1, .fanout = 4, .growth = 2,
+        .doubles = 16, .scalars = "nbiiuussdfxxe",
+        .string_max = 200, .nonascii = 8, .escapes = 128,
+        .unicode = "l", .density = 4,
+        .key_min = 3, .key_max = 12, .keys = 64,
+        .int_max = 1000000, .wide = true, .negative = true, .full_uint = true,
+        .double_max = 1000, .nonfinite = 8,
+        .blob_max = 4096,
+    },
+};
+
+static const generator_profile_t* profile = &generator_profiles[0];
+
+void generator_use(const generator_profile_t* new_profile) {
+    profile = new_profile;
+}
+
+const generator_profile_t* generator_profile(void) {
+    return profile;
+}
+
+// the types supported by the format of the objects being generated
+static int support = GENERATOR_SUPPORTS_ALL;
+
+void generator_support(int types) {
+    support = types;
+}
+
+// the fields that can be set in a profile file
+typedef enum field_type_t {
+    field_int,
+    field_uint,
+    field_uint64,
+    field_bool,
+    field_mix,
+} field_type_t;
+
+typedef struct profile_field_t {
+    const char* name;
+    field_type_t type;
+    size_t offset;
+} profile_field_t;
+
+#define PROFILE_FIELD(name, type) {#name, type, offsetof(generator_profile_t, name)}
+
+static const profile_field_t profile_fields[] = {
+    PROFILE_FIELD(max_depth, field_int),
+    PROFILE_FIELD(nesting, field_uint),
+    PROFILE_FIELD(maps, field_uint),
+    PROFILE_FIELD(arrays, field_uint),
+    PROFILE_FIELD(fanout, field_uint),
+    PROFILE_FIELD(growth, field_uint),
+    PROFILE_FIELD(doubles, field_uint),
+    PROFILE_FIELD(scalars, field_mix),
+    PROFILE_FIELD(string_min, field_uint),
+    PROFILE_FIELD(string_max, field_uint),
+    PROFILE_FIELD(nonascii, field_uint),
+    PROFILE_FIELD(key_min, field_uint),
+    PROFILE_FIELD(key_max, field_uint),
+    PROFILE_FIELD(keys, field_uint),
+    PROFILE_FIELD(int_max, field_uint),
+    PROFILE_FIELD(wide, field_bool),
+    PROFILE_FIELD(negative, field_bool),
+    PROFILE_FIELD(double_max, field_uint),
+    PROFILE_FIELD(schema, field_uint),
+    PROFILE_FIELD(optional, field_uint),
+    PROFILE_FIELD(homogeneous, field_bool),
+    PROFILE_FIELD(int_base, field_uint64),
+    PROFILE_FIELD(escapes, field_uint),
+    PROFILE_FIELD(controls, field_bool),
+    PROFILE_FIELD(unicode, field_mix),
+    PROFILE_FIELD(density, field_uint),
+    PROFILE_FIELD(ascii_run, field_uint),
+    PROFILE_FIELD(blob_min, field_uint),
+    PROFILE_FIELD(blob_max, field_uint),
+    PROFILE_FIELD(full_uint, field_bool),
+    PROFILE_FIELD(nonfinite, field_uint),
+};
+
+#define PROFILE_FIELD_COUNT (sizeof(profile_fields) / sizeof(*profile_fields))
+
+// the largest vocabulary of keys
+#define VOCABULARY_MAX 4096
+
+// the most fields in a record schema
+#define SCHEMA_MAX 256
+
+// the name is used in data filenames and results
+static bool profile_name_valid(const char* name) {
+    return name[0] != '\0' && strspn(name, "abcdefghijklmnopqrstuvwxyz"
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") == strlen(name);
+}
+
+// Checks that the profile can't hang the generator or overflow its lengths.
+static const char* profile_check(const generator_profile_t* profile) {
+    if (!profile_name_valid(profile->name))
+        return "the name must be letters, digits and underscores (set it with \"name = NAME\")";
+    if (profile->max_depth < 1 || profile->max_depth > 31)
+        return "max_depth must be in the range [1,31]";
+    if (profile->nesting < 1)
+        return "nesting must be at least 1";
+    if (profile->maps + profile->arrays < 1)
+        return "maps and arrays can't both be 0";
+    if (profile->fanout < 1 || profile->fanout > 64)
+        return "fanout must be in the range [1,64]";
+    if (profile->growth < 1 || profile->growth > 8)
+        return "growth must be in the range [1,8]";
+    if (profile->scalars[0] == '\0' || strspn(profile->scalars, "nbiusdfxe") != strlen(profile->scalars))
+        return "scalars must be a non-empty string of the letters n, b, i, u, s, d, f, x and e";
+    if (profile->unicode[0] == '\0' || strspn(profile->unicode, "lce") != strlen(profile->unicode))
+        return "unicode must be a non-empty string of the letters l, c and e";
+    if (profile->density < 1)
+        return "density must be at least 1";
+    if (profile->string_max < profile->string_min)
+        return "string_max must be at least string_min";
+    if (profile->blob_max < profile->blob_min)
+        return "blob_max must be at least blob_min";
+    if (profile->key_min < 1 || profile->key_max < profile->key_min)
+        return "key_min must be at least 1 and key_max at least key_min";
+    if (profile->keys > VOCABULARY_MAX)
+        return "keys must be at most " GENERATOR_STRINGIFY(VOCABULARY_MAX);
+    if (profile->int_base > (uint64_t)INT64_MAX - profile->int_max)
+        return "int_base plus int_max must be at most INT64_MAX";
+    if (profile->schema > SCHEMA_MAX)
+        return "schema must be at most " GENERATOR_STRINGIFY(SCHEMA_MAX);
+    return NULL;
+}
+
+// the file's name without its directory or extension
+static void profile_name(char* name, size_t size, const char* filename) {
+    const char* base = strrchr(filename, '/');
+    base = base ? base + 1 : filename;
+    size_t length = strcspn(base, ".");
+    if (length >= size)
+        length = size - 1;
+    memcpy(name, base, length);
+    name[length] = '\0';
+}
+
+// trims leading and trailing whitespace in place
+static char* trim(char* str) {
+    while (*str == ' ' || *str == '\t')
+        ++str;
+    size_t length = strlen(str);
+    while (length > 0 && strchr(" \t\r\n", str[length - 1]))
+        str[--length] = '\0';
+    return str;
+}
+
+static bool profile_set(generator_profile_t* profile, const char* key, const char* value) {
+    if (strcmp(key, "name") == 0) {
+        if (strlen(value) >= sizeof(profile->name) || !profile_name_valid(value))
+            return false;
+        strcpy(profile->name, value);
+        return true;
+    }
+
+    for (size_t i = 0; i < PROFILE_FIELD_COUNT; ++i) {
+        const profile_field_t* field = &profile_fields[i];
+        if (strcmp(key, field->name) != 0)
+            continue;
+        char* pointer = (char*)profile + field->offset;
+        char* end;
+        switch (field->type) {
+            case field_int: {
+                long number = strtol(value, &end, 0);
+                if (end == value || *end != '\0')
+                    return false;
+                *(int*)pointer = (int)number;
+                return true;
+            }
+            case field_uint: {
+                unsigned long long number = strtoull(value, &end, 0);
+                if (end == value || *end != '\0' || value[0] == '-' || number > UINT32_MAX)
+                    return false;
+                *(uint32_t*)pointer = (uint32_t)number;
+                return true;
+            }
+            case field_uint64: {
+                unsigned long long number = strtoull(value, &end, 0);
+                if (end == value || *end != '\0' || value[0] == '-')
+                    return false;
+                *(uint64_t*)pointer = (uint64_t)number;
+                return true;
+            }
+            case field_bool:
+                if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0)
+                    *(bool*)pointer = true;
+                else if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0)
+                    *(bool*)pointer = false;
+                else
+                    return false;
+                return true;
+            case field_mix:
+                if (strlen(value) >= GENERATOR_MIX_MAX)
+                    return false;
+                strcpy(pointer, value);
+                return true;
+        }
+    }
+    return false;
+}
+
+bool generator_profile_load(const char* filename, generator_profile_t* out) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "%s: could not open profile\n", filename);
+        return false;
+    }
+
+    generator_profile_t loaded = generator_profiles[0];
+    profile_name(loaded.name, sizeof(loaded.name), filename);
+    char line[256];
+    int number = 0;
+    bool ok = true;
+    bool fields = false; // whether a field has been set, after which "base" isn't allowed
+    while (ok && fgets(line, sizeof(line), file)) {
+        ++number;
+        char* comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        char* key = trim(line);
+        if (*key == '\0')
+            continue;
+        char* equals = strchr(key, '=');
+        if (!equals) {
+            fprintf(stderr, "%s:%i: expected \"field = value\"\n", filename, number);
+            ok = false;
+            break;
+        }
+        *equals = '\0';
+        char* value = trim(equals + 1);
+        key = trim(key);
+
+        if (strcmp(key, "base") == 0) {
+            size_t i = 0;
+            while (i < GENERATOR_PROFILE_COUNT && strcmp(value, generator_profiles[i].name) != 0)
+                ++i;
+            if (fields || i == GENERATOR_PROFILE_COUNT) {
+                fprintf(stderr, "%s:%i: base must be a built-in profile, before any fields\n", filename, number);
+                ok = false;
+                break;
+            }
+            char name[sizeof(loaded.name)];
+            strcpy(name, loaded.name);
+            loaded = generator_profiles[i];
+            strcpy(loaded.name, name);
+            continue;
+        }
+
+        fields = true;
+        if (!profile_set(&loaded, key, value)) {
+            fprintf(stderr, "%s:%i: unknown field or invalid value \"%s\"\n", filename, number, key);
+            ok = false;
+        }
+    }
+    fclose(file);
+    if (!ok)
+        return false;
+
+    const char* error = profile_check(&loaded);
+    if (error) {
+        fprintf(stderr, "%s: %s\n", filename, error);
+        return false;
+    }
+    *out = loaded;
+    return true;
+}
+
+
+
 // Some random object generation functions
 
 // generates short lowercase ascii keys, realistic for real-world data
 // (null-terminated for certain APIs that may require it)
 static char* random_key(random_t* random) {
-    uint32_t length = random_next(random) % 9 + 2;
+    uint32_t length = random_next(random) % (profile->key_max - profile->key_min + 1) + profile->key_min;
     char* str = (char*)malloc(length + 1);
     for (int i = 0; i < length; ++i)
         str[i] = 'a' + (random_next(random) % ('z' - 'a' + 1));
@@ -71,22 +455,83 @@ static char* random_key(random_t* random) {
     return str;
 }
 
-// generates a random string of the given length (null-terminated for
-// certain APIs that may require it)
+// generates a character that might need to be escaped
+static char random_special(random_t* random) {
+    if (!profile->controls) {
+        char specials[] = {'\n', '"', '\\'};
+        return specials[random_next(random) % sizeof(specials)];
+    }
+
+    // with control characters, sometimes any of them but null (strings
+    // are null-terminated for certain APIs)
+    char specials[] = {'\n', '"', '\\', '\t', '\r', '/', '\b', '\f'};
+    uint32_t index = random_next(random) % (sizeof(specials) + 2);
+    if (index < sizeof(specials))
+        return specials[index];
+    return (char)(1 + random_next(random) % 0x1F);
+}
+
+// generates a utf-8 non-ascii character of at most the given number of
+// bytes (at least 2), returning its length
+static uint32_t random_unicode(random_t* random, char* str, uint32_t space) {
+    size_t mix = strlen(profile->unicode);
+    char kind = mix == 1 ? profile->unicode[0] : profile->unicode[random_next(random) % mix];
+    if ((kind == 'c' && space < 3) || (kind == 'e' && space < 4))
+        kind = 'l';
+
+    uint32_t codepoint;
+    switch (kind) {
+        case 'c':
+            // a CJK unified ideograph
+            codepoint = 0x4E00 + random_next(random) % 0x5200;
+            str[0] = (char)(0xE0 | (codepoint >> 12));
+            str[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+            str[2] = (char)(0x80 | (codepoint & 0x3F));
+            return 3;
+        case 'e':
+            // an emoji or pictograph, outside the basic multilingual plane
+            codepoint = 0x1F300 + random_next(random) % 0x350;
+            str[0] = (char)(0xF0 | (codepoint >> 18));
+            str[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+            str[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+            str[3] = (char)(0x80 | (codepoint & 0x3F));
+            return 4;
+        default:
+            // a character from Latin-1 supplement
+            codepoint = 0xA1 + random_next(random) % 0x5F;
+            str[0] = (char)(0xC0 | ((codepoint >> 6) & 0x1F));
+            str[1] = (char)(0x80 | (codepoint & 0x3F));
+            return 2;
+    }
+}
+
+// generates a random string of the given length in bytes (null-terminated
+// for certain APIs that may require it)
 static char* random_string(random_t* random, uint32_t length) {
     char* str = (char*)malloc(length + 1);
 
     // we'll assume most non-key strings don't have non-ascii characters
     // (all key strings are generated as lowercase ascii letters)
-    bool ascii = random_next(random) % 4 != 0;
+    bool ascii = profile->nonascii == 0 || random_next(random) % profile->nonascii != 0;
 
     // a string might have either lots of spaces (words) or
     // no spaces (miscellaneous small data, urls, etc.)
     bool spaces = length > 50 || (random_next(random) % 4) != 0;
     int next_space = (random_next(random) % 8) + 2;
 
+    // in a profile with ascii runs, a non-ascii string alternates between
+    // runs of text and runs of pure ascii (e.g. quoted code or urls)
+    bool runs = !ascii && profile->ascii_run > 0;
+    bool ascii_run = false;
+    uint32_t run = runs ? random_next(random) % profile->ascii_run + 1 : 0;
+
     for (int i = 0; i < length; ++i) {
 
+        if (runs && --run == 0) {
+            ascii_run = !ascii_run;
+            run = random_next(random) % profile->ascii_run + 1;
+        }
+
         // lots of spaces
         if (spaces && next_space-- == 0) {
             next_space = (random_next(random) % 8) + 2;
@@ -95,18 +540,14 @@ static char* random_string(random_t* random, uint32_t length) {
         }
 
         // rarely, generate a character that might need to be escaped
-        if (random_next(random) % 128 == 0) {
-            char specials[] = {'\n', '"', '\\'};
-            str[i] = specials[random_next(random) % sizeof(specials)];
+        if (profile->escapes > 0 && random_next(random) % profile->escapes == 0) {
+            str[i] = random_special(random);
             continue;
         }
 
-        // generate a utf-8 non-ascii character (for now a
-        // character from Latin-1 supplement)
-        if (!ascii && (length - i) >= 2 && random_next(random) % 4 == 0) {
-            uint32_t codepoint = 0xA1 + random_next(random) % 0x5F;
-            str[i++] = (char)(0xC0 | ((codepoint >> 6) & 0x1F));
-            str[i]   = (char)(0x80 | (codepoint & 0x3F));
+        // generate a utf-8 non-ascii character
+        if (!ascii && !ascii_run && (length - i) >= 2 && random_next(random) % profile->density == 0) {
+            i += random_unicode(random, str + i, length - i) - 1;
             continue;
         }
 
@@ -127,56 +568,138 @@ static char* random_string(random_t* random, uint32_t length) {
     return str;
 }
 
+// In a profile with a vocabulary, keys are drawn from a fixed set of
+// words, generated with their own seed so that every document shares them.
+#define VOCABULARY_SEED 2718281828u
+
+static char** vocabulary;
+
+static void vocabulary_create(void) {
+    if (profile->keys == 0)
+        return;
+    random_t random;
+    random_seed(&random, VOCABULARY_SEED);
+    vocabulary = (char**)malloc(profile->keys * sizeof(char*));
+    for (uint32_t i = 0; i < profile->keys; ++i)
+        vocabulary[i] = random_key(&random);
+}
+
+static void vocabulary_destroy(void) {
+    if (!vocabulary)
+        return;
+    for (uint32_t i = 0; i < profile->keys; ++i)
+        free(vocabulary[i]);
+    free(vocabulary);
+    vocabulary = NULL;
+}
+
+// Generates the key of the given attempt at a unique key. Keys are drawn
+// from the vocabulary, with an inverse distribution so that some are far
+// more common than others, until it's likely exhausted, and are random
+// after that. A short key range may not have enough distinct keys for a
+// large map or schema, so after many attempts the random key gets the
+// attempt number as a suffix, which is eventually unique.
+static char* map_key(random_t* random, int attempt) {
+    if (attempt >= 64) {
+        char* key = random_key(random);
+        size_t length = strlen(key);
+        char* str = (char*)realloc(key, length + 12);
+        snprintf(str + length, 12, "%i", attempt - 64);
+        return str;
+    }
+    if (!vocabulary || attempt >= 8)
+        return random_key(random);
+    const char* word = vocabulary[random_inverse(random, profile->keys) % profile->keys];
+    size_t length = strlen(word);
+    char* str = (char*)malloc(length + 1);
+    memcpy(str, word, length + 1);
+    return str;
+}
+
+// generates a random container length close to the size
+static int container_length(random_t* random, int size, int depth) {
+    int len = (int)profile->fanout;
+    while (size-- > depth)
+        len *= (int)profile->growth;
+    len += random_next(random) % len;
+    return len;
+}
+
+static uint32_t string_length(random_t* random) {
+    return profile->string_min + random_inverse(random, profile->string_max - profile->string_min);
+}
+
+static uint32_t blob_length(random_t* random) {
+    return profile->blob_min + random_inverse(random, profile->blob_max - profile->blob_min);
+}
+
+// the length of a scalar of the given type
+static uint32_t scalar_length(random_t* random, type_t type) {
+    if (type == type_str)
+        return string_length(random);
+    if (type == type_bin || type == type_ext)
+        return blob_length(random);
+    return 0;
+}
+
+static type_t random_scalar(random_t* random, uint32_t* length);
+
 static type_t random_type(random_t* random, int size, int depth, uint32_t* length) {
     *length = 0;
 
     // the odds of a map or array are proportional to the depth. at
     // the base depth it's always one or the other.
-    int odds = 2;
+    uint64_t odds = profile->nesting;
     int d = depth;
     while (d-- > 0)
         odds <<= 1;
-    if (depth < 31 && random_next(random) % odds <= 2) {
-        type_t type = (random_next(random) & 1) ? type_map : type_array;
-
-        // generate a random length close to the size
-        int len = 3;
-        while (size-- > depth)
-            len *= 2;
-        len += random_next(random) % len;
+    if (depth < profile->max_depth && (random_next(random) % odds <= 2 || depth == 0)) {
+        type_t type = (random_next(random) % (profile->maps + profile->arrays) >= profile->arrays) ?
+                type_map : type_array;
+        int len = container_length(random, size, depth);
         if (type == type_map)
             len /= 2;
         *length = len;
         return type;
     }
 
+    return random_scalar(random, length);
+}
+
+static type_t random_scalar(random_t* random, uint32_t* length) {
+    *length = 0;
+
     // reals are probably pretty rare
-    if (random_next(random) % 64 == 0)
+    if (profile->doubles != 0 && random_next(random) % profile->doubles == 0)
         return type_double;
 
-    // the rest we distribute with a simple switch
-    switch (random_next(random) % 8) {
-
-        case 0:
+    // the rest we distribute by the profile's mix. we get plenty of short
+    // strings as map keys; by default we take 1/4 map/array values as
+    // potentially long strings.
+    switch (profile->scalars[random_next(random) % strlen(profile->scalars)]) {
+        case 'n':
             return type_nil;
-        case 1:
+        case 'b':
             return type_bool;
-        case 3:
+        case 'u':
             return type_uint;
-        case 4:
-        case 5:
-        case 6:
+        case 'i':
             return type_int;
-        case 7:
-            // we get plenty of short strings as map keys. we'll
-            // take 1/8 map/array values as potentially long strings
-            break;
-
+        case 'd':
+            return type_double;
+        case 'f':
+            return type_float;
+        case 'x':
+            *length = blob_length(random);
+            return type_bin;
+        case 'e':
+            *length = blob_length(random);
+            return type_ext;
         default:
             break;
     }
 
-    *length = random_inverse(random, 1000);
+    *length = string_length(random);
     return type_str;
 }
 
@@ -186,61 +709,216 @@ static size_t object_align(size_t size) {
     return (size + alignment - 1) & (~(alignment-1));
 }
 
-static void object_init(object_t* object, random_t* random, int size, int depth, size_t* total_size) {
-    uint32_t length;
-    object->type = random_type(random, size, depth, &length);
+// generates a real number, or sometimes NaN or infinity if the profile allows
+static double random_real(random_t* random) {
+    if (profile->nonfinite != 0 && random_next(random) % profile->nonfinite == 0) {
+        double nonfinite[] = {NAN, INFINITY, -INFINITY};
+        return nonfinite[random_next(random) % 3];
+    }
+
+    double d = (double)((int64_t)(random_next(random) % (2 * profile->double_max)) -
+            (int64_t)profile->double_max);
+    // we add lots of mantissa to try to use the full range of doubles
+    d += (double)(random_next(random) % 1024) / 1024.0;
+    d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0);
+    d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0 * 1024.0);
+    d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0 * 1024.0 * 1024.0);
+    d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0 * 1024.0 * 1024.0 * 1024.0);
+    return d;
+}
+
+// generates the data of a binary blob, or the type and data of an extension
+// (see object_ext_type().) a quarter of extensions are MessagePack timestamps
+// (type -1), which are always 8 bytes. the data is null-terminated like a
+// string, although it may also contain nulls.
+static char* random_blob(random_t* random, type_t type, uint32_t* length) {
+    char* str;
+    char* data;
+    if (type == type_ext) {
+        bool timestamp = random_next(random) % 4 == 0;
+        if (timestamp)
+            *length = 8;
+        str = (char*)malloc(*length + 2);
+        str[0] = (char)(timestamp ? -1 : (int8_t)(random_next(random) % 128));
+        data = str + 1;
+        if (timestamp) {
+            // 30 bits of nanoseconds and 34 bits of seconds, big-endian
+            uint64_t seconds = UINT64_C(1700000000) + random_next(random) % (86400 * 365);
+            uint64_t value = ((uint64_t)(random_next(random) % 1000000000) << 34) | seconds;
+            for (int i = 0; i < 8; ++i)
+                data[i] = (char)(value >> (56 - i * 8));
+            data[8] = '\0';
+            return str;
+        }
+    } else {
+        str = data = (char*)malloc(*length + 1);
+    }
+
+    for (uint32_t i = 0; i < *length; ++i)
+        data[i] = (char)random_next(random);
+    data[*length] = '\0';
+    return str;
+}
+
+// the number of bytes of string or binary data an object has, including the
+// null-terminator (and an extension's type)
+static size_t object_data_size(const object_t* object) {
+    switch (object->type) {
+        case type_str:
+        case type_bin:
+            return object->l + 1;
+        case type_ext:
+            return object->l + 2;
+        default:
+            return 0;
+    }
+}
+
+// encodes data as a null-terminated base64 string
+static char* base64_encode(const char* data, uint32_t length, uint32_t* encoded_length) {
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    *encoded_length = (length + 2) / 3 * 4;
+    char* str = (char*)malloc(*encoded_length + 1);
+    const unsigned char* bytes = (const unsigned char*)data;
+    char* out = str;
+    for (uint32_t i = 0; i < length; i += 3) {
+        uint32_t left = length - i;
+        uint32_t group = (uint32_t)bytes[i] << 16;
+        if (left > 1)
+            group |= (uint32_t)bytes[i + 1] << 8;
+        if (left > 2)
+            group |= bytes[i + 2];
+        *out++ = digits[(group >> 18) & 0x3F];
+        *out++ = digits[(group >> 12) & 0x3F];
+        *out++ = left > 1 ? digits[(group >> 6) & 0x3F] : '=';
+        *out++ = left > 2 ? digits[group & 0x3F] : '=';
+    }
+    *out = '\0';
+    return str;
+}
+
+// converts a scalar of a type the format doesn't support to the nearest
+// type it does (see generator_support())
+static void scalar_lower(object_t* object) {
+    if (object->type == type_float && !(support & GENERATOR_SUPPORTS_FLOAT)) {
+        double d = object->f;
+        object->type = type_double;
+        object->d = d;
+    }
+
+    if (object->type == type_uint && object->u > (uint64_t)INT64_MAX && !(support & GENERATOR_SUPPORTS_UINT64)) {
+        double d = (double)object->u;
+        object->type = type_double;
+        object->d = d;
+    }
+
+    if (!(support & GENERATOR_SUPPORTS_NONFINITE) &&
+            ((object->type == type_double && !isfinite(object->d)) ||
+             (object->type == type_float && !isfinite(object->f))))
+        object->type = type_nil;
+
+    // an extension's type already precedes its data
+    if (object->type == type_ext && !(support & GENERATOR_SUPPORTS_EXT)) {
+        object->type = type_bin;
+        object->l += 1;
+    }
+
+    if (object->type == type_bin && !(support & GENERATOR_SUPPORTS_BIN)) {
+        uint32_t length;
+        char* str = base64_encode(object->str, object->l, &length);
+        free(object->str);
+        object->type = type_str;
+        object->str = str;
+        object->l = length;
+    }
+}
+
+// lowers every scalar of a generated object, updating its total size. this
+// is done once the object is complete so that the format doesn't affect
+// what's generated (e.g. the types of homogeneous containers.)
+static void object_lower(object_t* object, size_t* total_size) {
+    if (object->type == type_map) {
+        for (size_t i = 0; i < object->l * 2; ++i)
+            object_lower(object->children + i, total_size);
+    } else if (object->type == type_array) {
+        for (size_t i = 0; i < object->l; ++i)
+            object_lower(object->children + i, total_size);
+    } else {
+        *total_size -= object_align(object_data_size(object));
+        scalar_lower(object);
+        *total_size += object_align(object_data_size(object));
+    }
+}
+
+static void object_init(object_t* object, random_t* random, int size, int depth, size_t* total_size);
+
+static void scalar_init(object_t* object, random_t* random, type_t type, size_t* total_size);
 
+// whether the rest of a container's scalars take the type of the given first one
+static bool homogeneous(const object_t* first) {
+    return profile->homogeneous && first->type != type_array && first->type != type_map;
+}
+
+// generates the value of an object of the type already set
+static void object_fill(object_t* object, random_t* random, uint32_t length, int size, int depth, size_t* total_size) {
     switch (object->type) {
         case type_bool:
             object->b = random_next(random) & 1;
             break;
 
-        case type_double: {
-            // we should probably make it possible to generate nan and infinity here
-            object->d = (double)((int)(random_next(random) % 2048) - 1024);
-            // we add lots of mantissa to try to use the full range of doubles
-            object->d += (double)(random_next(random) % 1024) / 1024.0;
-            object->d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0);
-            object->d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0 * 1024.0);
-            object->d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0 * 1024.0 * 1024.0);
-            object->d += (double)(random_next(random) % 1024) / (1024.0 * 1024.0 * 1024.0 * 1024.0 * 1024.0);
+        case type_double:
+            object->d = random_real(random);
+            break;
+        case type_float:
+            object->f = (float)random_real(random);
             break;
-        }
 
         // sometimes numbers are huge, and we want to test 64-bit. but
         // usually they're very small.
         case type_uint:
-            if (random_inverse(random, 10000) > 5000) {
-                // note: we don't allow numbers in the range [INT64_MAX, UINT64_MAX)
-                object->u = ((uint64_t)(random_next(random) & ~(1<<31))) << 32;
+            if (profile->wide && random_inverse(random, 10000) > 5000) {
+                // note: we don't allow numbers in the range [INT64_MAX, UINT64_MAX]
+                // unless the profile asks for them
+                object->u = ((uint64_t)(random_next(random) & (profile->full_uint ? ~0u : ~(1u<<31)))) << 32;
                 object->u |= (uint64_t)random_next(random);
             } else {
-                object->u = random_inverse(random, 0xfffff);
+                object->u = random_inverse(random, profile->int_max) + profile->int_base;
             }
             break;
         case type_int:
-            if (random_inverse(random, 10000) > 5000) {
+            if (profile->wide && random_inverse(random, 10000) > 5000) {
                 uint64_t u = ((uint64_t)random_next(random)) << 32;
                 u |= (uint64_t)random_next(random);
                 object->i = (int64_t)u;
             } else {
-                object->i = random_inverse(random, 0xfffff);
-                object->i *= (random_next(random) & 1) ? -1 : 1;
+                object->i = random_inverse(random, profile->int_max);
+                if (profile->negative)
+                    object->i *= (random_next(random) & 1) ? -1 : 1;
+                object->i += (int64_t)profile->int_base;
             }
             break;
 
         case type_str:
-            *total_size += object_align(length + 1);
             object->l = length;
             object->str = random_string(random, length);
             break;
 
+        case type_bin:
+        case type_ext:
+            object->l = length;
+            object->str = random_blob(random, object->type, &object->l);
+            break;
+
         case type_array:
             *total_size += object_align(length * sizeof(object_t));
             object->l = length;
             object->children = (object_t*)malloc(length * sizeof(object_t));
-            for (int i = 0; i < length; ++i)
-                object_init(object->children + i, random, size, depth + 1, total_size);
+            for (int i = 0; i < length; ++i) {
+                if (i > 0 && homogeneous(object->children))
+                    scalar_init(object->children + i, random, object->children[0].type, total_size);
+                else
+                    object_init(object->children + i, random, size, depth + 1, total_size);
+            }
             break;
 
         case type_map:
@@ -253,9 +931,10 @@ static void object_init(object_t* object, random_t* random, int size, int depth,
                 // actually check for this (e.g. binn.)
                 bool unique;
                 char* key = NULL;
+                int attempt = 0;
                 do {
                     free(key);
-                    key = random_key(random);
+                    key = map_key(random, attempt++);
                     unique = true;
                     for (int j = 0; j < i; ++j) {
                         if (strcmp(key, object->children[j * 2].str) == 0) {
@@ -272,17 +951,132 @@ static void object_init(object_t* object, random_t* random, int size, int depth,
                 object->children[i * 2].l = strlen(object->children[i * 2].str);
                 *total_size += object_align(object->children[i * 2].l + 1);
 
-                object_init(object->children + i * 2 + 1, random, size, depth + 1, total_size);
+                if (i > 0 && homogeneous(object->children + 1))
+                    scalar_init(object->children + i * 2 + 1, random, object->children[1].type, total_size);
+                else
+                    object_init(object->children + i * 2 + 1, random, size, depth + 1, total_size);
             }
             break;
 
         default:
             break;
     }
+
+    *total_size += object_align(object_data_size(object));
+}
+
+static void object_init(object_t* object, random_t* random, int size, int depth, size_t* total_size) {
+    uint32_t length;
+    object->type = random_type(random, size, depth, &length);
+    object_fill(object, random, length, size, depth, total_size);
+}
+
+// generates a scalar of the given type
+static void scalar_init(object_t* object, random_t* random, type_t type, size_t* total_size) {
+    object->type = type;
+    object_fill(object, random, scalar_length(random, type), 0, 0, total_size);
+}
+
+// In a profile with a schema, the root is an array of records: maps with
+// the fields of a fixed schema in order, each with a fixed type. Optional
+// fields are missing from about half of the records, and nullable fields
+// (those whose type was drawn as nil) are null in about a quarter of them.
+// The schema is generated with its own seed so that every document shares it.
+#define SCHEMA_SEED 1414213562u
+
+typedef struct field_t {
+    char* key;
+    type_t type;
+    bool optional;
+    bool nullable;
+} field_t;
+
+static field_t* schema;
+
+static void schema_create(void) {
+    if (profile->schema == 0)
+        return;
+    random_t random;
+    random_seed(&random, SCHEMA_SEED);
+    schema = (field_t*)calloc(profile->schema, sizeof(field_t));
+    for (uint32_t i = 0; i < profile->schema; ++i) {
+        bool unique;
+        char* key = NULL;
+        int attempt = 0;
+        do {
+            free(key);
+            key = map_key(&random, attempt++);
+            unique = true;
+            for (uint32_t j = 0; j < i; ++j) {
+                if (strcmp(key, schema[j].key) == 0) {
+                    unique = false;
+                    break;
+                }
+            }
+        } while (!unique);
+        schema[i].key = key;
+
+        uint32_t length;
+        schema[i].type = random_scalar(&random, &length);
+        for (int retry = 0; schema[i].type == type_nil && retry < 8; ++retry) {
+            schema[i].nullable = true;
+            schema[i].type = random_scalar(&random, &length);
+        }
+        schema[i].optional = profile->optional != 0 && random_next(&random) % profile->optional == 0;
+    }
+}
+
+static void schema_destroy(void) {
+    if (!schema)
+        return;
+    for (uint32_t i = 0; i < profile->schema; ++i)
+        free(schema[i].key);
+    free(schema);
+    schema = NULL;
+}
+
+static void record_init(object_t* object, random_t* random, size_t* total_size) {
+    bool present[SCHEMA_MAX];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < profile->schema; ++i) {
+        present[i] = !schema[i].optional || (random_next(random) & 1);
+        if (present[i])
+            ++count;
+    }
+
+    object->type = type_map;
+    object->l = count;
+    *total_size += object_align(2 * count * sizeof(object_t));
+    object->children = (object_t*)malloc(2 * count * sizeof(object_t));
+    object_t* child = object->children;
+    for (uint32_t i = 0; i < profile->schema; ++i) {
+        if (!present[i])
+            continue;
+        child->type = type_str;
+        child->l = (uint32_t)strlen(schema[i].key);
+        child->str = (char*)malloc(child->l + 1);
+        memcpy(child->str, schema[i].key, child->l + 1);
+        *total_size += object_align(child->l + 1);
+        ++child;
+
+        bool null = schema[i].nullable && random_next(random) % 4 == 0;
+        scalar_init(child, random, null ? type_nil : schema[i].type, total_size);
+        ++child;
+    }
+}
+
+static void records_init(object_t* object, random_t* random, int size, size_t* total_size) {
+    uint32_t length = (uint32_t)container_length(random, size, 0);
+    object->type = type_array;
+    object->l = length;
+    *total_size += object_align(length * sizeof(object_t));
+    object->children = (object_t*)malloc(length * sizeof(object_t));
+    for (uint32_t i = 0; i < length; ++i)
+        record_init(object->children + i, random, total_size);
 }
 
 static void object_teardown(object_t* object) {
-    if (object->type == type_str) {
+    if (object_data_size(object) > 0) {
         free(object->str);
     } else if (object->type == type_map) {
         for (int i = 0; i < object->l * 2; ++i)
@@ -310,45 +1104,158 @@ static char* object_copy(object_t* dest, object_t* src, char* pool) {
         for (size_t i = 0; i < src->l; ++i)
             pool = object_copy(dest->children + i, src->children + i, pool);
 
-    } else if (src->type == type_str) {
+    } else if (object_data_size(src) > 0) {
         dest->str = pool;
-        memcpy(dest->str, src->str, src->l + 1);
-        pool += object_align(src->l + 1);
+        memcpy(dest->str, src->str, object_data_size(src));
+        pool += object_align(object_data_size(src));
     }
 
     return pool;
 }
 
+// copies the object into a contiguous chunk of memory of the given total
+// size and destroys the original
+static object_t* object_flatten(object_t* src, size_t total_size) {
+    char* pool = (char*)malloc(total_size);
+    object_t* dest = (object_t*)pool;
+    pool += object_align(sizeof(object_t));
+    object_copy(dest, src, pool);
+
+    object_teardown(src);
+    free(src);
+    return dest;
+}
+
 object_t* object_create(uint64_t seed, int size) {
     random_t random;
     random_seed(&random, seed);
 
     // first we create an object, tracking its total size
+    vocabulary_create();
+    schema_create();
     object_t* src = (object_t*)malloc(sizeof(object_t));
     size_t total_size = object_align(sizeof(object_t));
-    object_init(src, &random, size, 0, &total_size);
+    if (schema)
+        records_init(src, &random, size, &total_size);
+    else
+        object_init(src, &random, size, 0, &total_size);
+    schema_destroy();
+    vocabulary_destroy();
+    if (support != GENERATOR_SUPPORTS_ALL)
+        object_lower(src, &total_size);
 
     // next we allocate a contiguous chunk of memory and copy
     // the object into it
-    char* pool = (char*)malloc(total_size);
-    object_t* dest = (object_t*)pool;
-    pool += object_align(sizeof(object_t));
-    object_copy(dest, src, pool);
-
-    object_teardown(src);
-    free(src);
-    return dest;
+    return object_flatten(src, total_size);
     /*
     (void)object_teardown;
     return src;
     */
 }
 
+// the size of a MessagePack length or integer header for the given value
+static size_t header_estimate(uint64_t value, uint64_t fixed) {
+    if (value < fixed)
+        return 1;
+    if (value <= UINT8_MAX && fixed != 16) // there are no 8-bit array or map lengths
+        return 2;
+    if (value <= UINT16_MAX)
+        return 3;
+    if (value <= UINT32_MAX)
+        return 5;
+    return 9;
+}
+
+// estimates the encoded size of an object in MessagePack
+static size_t object_estimate(const object_t* object) {
+    size_t size = 0;
+    switch (object->type) {
+        case type_nil:
+        case type_bool:
+            return 1;
+        case type_float:
+            return 5;
+        case type_double:
+            return 9;
+        case type_int:
+            return header_estimate(object->i < 0 ? -(uint64_t)object->i : (uint64_t)object->i, 128);
+        case type_uint:
+            return header_estimate(object->u, 128);
+        case type_str:
+            return header_estimate(object->l, 32) + object->l;
+        case type_bin:
+            return header_estimate(object->l, 0) + object->l;
+        case type_ext:
+            return header_estimate(object->l, 0) + 1 + object->l;
+        case type_array:
+            size = header_estimate(object->l, 16);
+            for (size_t i = 0; i < object->l; ++i)
+                size += object_estimate(object->children + i);
+            return size;
+        case type_map:
+            size = header_estimate(object->l, 16);
+            for (size_t i = 0; i < object->l * 2; ++i)
+                size += object_estimate(object->children + i);
+            return size;
+        default:
+            return 0;
+    }
+}
+
+object_t* object_create_sized(uint64_t seed, size_t bytes) {
+    random_t random;
+    random_seed(&random, seed);
+
+    object_t* src = (object_t*)malloc(sizeof(object_t));
+    size_t total_size = object_align(sizeof(object_t));
+    src->type = type_array;
+    src->l = 0;
+    size_t capacity = 16;
+    src->children = (object_t*)malloc(capacity * sizeof(object_t));
+
+    // the elements are generated as though they were one level down in
+    // an object of size 1, so each is a few hundred bytes at most
+    size_t estimate = header_estimate(0, 16);
+    vocabulary_create();
+    schema_create();
+    while (estimate < bytes) {
+        if (src->l == capacity) {
+            capacity *= 2;
+            src->children = (object_t*)realloc(src->children, capacity * sizeof(object_t));
+        }
+        object_t* child = src->children + src->l++;
+        if (schema)
+            record_init(child, &random, &total_size);
+        else
+            object_init(child, &random, 1, 1, &total_size);
+        estimate += object_estimate(child) + header_estimate(src->l, 16) - header_estimate(src->l - 1, 16);
+    }
+    schema_destroy();
+    vocabulary_destroy();
+    if (support != GENERATOR_SUPPORTS_ALL)
+        object_lower(src, &total_size);
+    total_size += object_align(src->l * sizeof(object_t));
+
+    return object_flatten(src, total_size);
+}
+
 void object_destroy(object_t* object) {
     // the external object is a flat array of data
     free(object);
 }
 
+size_t object_count(const object_t* object) {
+    size_t count = 1;
+    if (object->type == type_map) {
+        for (size_t i = 0; i < object->l * 2; ++i)
+            count += object_count(object->children + i);
+    } else if (object->type == type_array) {
+        for (size_t i = 0; i < object->l; ++i)
+            count += object_count(object->children + i);
+    }
+    return count;
+}
+
 #if 0
 int main(void) {
     random_t random;
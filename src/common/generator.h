@@ -56,22 +56,114 @@ typedef enum type_t {
     type_uint,
     type_str,
     type_array,
-    type_map
+    type_map,
+    type_float,
+    type_bin,
+    type_ext
 } type_t;
 
 typedef struct object_t {
     type_t type;
-    uint32_t l; // length of str, element count of array, key/value pair count of map
+    uint32_t l; // length of str or data, element count of array, key/value pair count of map
     union {
         bool b;
+        float f;
         double d;
         int64_t i;
         uint64_t u;
         struct object_t* children;
-        char* str; // null-terminated, but l is also the non-terminated length
+        char* str; // null-terminated, but l is also the non-terminated length. for bin
+                   // it's the data, which may contain nulls; for ext it's the extension
+                   // type followed by the data (see object_ext_type() and object_ext_data())
     };
 } object_t;
 
+static inline int8_t object_ext_type(const object_t* object) {
+    return (int8_t)object->str[0];
+}
+
+static inline const char* object_ext_data(const object_t* object) {
+    return object->str + 1;
+}
+
+// A workload profile controls the shape of the generated data. The default
+// profile is the distribution the generator has always used; the others
+// approximate particular kinds of real-world data. Profiles can also be
+// loaded from a file (see generator_profile_load().)
+// the size of the letter mixes in a profile
+#define GENERATOR_MIX_MAX 32
+
+typedef struct generator_profile_t {
+    char name[32];
+    int max_depth;       // containers are only generated above this depth
+    uint32_t nesting;    // the odds of a container are about 3 in (nesting << depth)
+    uint32_t maps;       // the relative odds of maps and arrays
+    uint32_t arrays;
+    uint32_t fanout;     // the length of containers at the deepest level
+    uint32_t growth;     // the factor by which lengths grow per size above the depth
+    uint32_t doubles;    // 1 in this many scalars are doubles (0 for none)
+    char scalars[GENERATOR_MIX_MAX]; // the mix of other scalars, one letter per share: n(il),
+                         // b(ool), i(nt), u(int), s(tring), d(ouble), f(loat), x (binary) or e(xt)
+    uint32_t string_min; // string lengths have an inverse distribution in this range
+    uint32_t string_max;
+    uint32_t nonascii;   // 1 in this many strings may be non-ASCII (0 for none)
+    uint32_t key_min;    // the range of key lengths
+    uint32_t key_max;
+    uint32_t keys;       // keys are drawn from a vocabulary of this many (0 for random keys)
+    uint32_t int_max;    // integers have an inverse distribution up to this
+    bool wide;           // whether integers are sometimes arbitrary 64-bit numbers
+    bool negative;       // whether integers can be negative
+    uint32_t double_max; // doubles are in (-double_max, double_max)
+    uint32_t schema;     // if not 0, the root is an array of records with this many fields
+    uint32_t optional;   // 1 in this many record fields are optional (0 for none)
+    bool homogeneous;    // whether the scalars in each container share the type of the first
+    uint64_t int_base;   // added to integers, e.g. to make them timestamps
+    uint32_t escapes;    // 1 in this many string characters may need escaping (0 for none)
+    bool controls;       // whether those include tabs, carriage returns and other control characters
+    char unicode[GENERATOR_MIX_MAX]; // the mix of non-ASCII characters, one letter per share:
+                         // l(atin-1, 2 bytes), c(jk, 3 bytes) or e(moji, 4 bytes)
+    uint32_t density;    // 1 in this many characters of a non-ASCII string are non-ASCII
+    uint32_t ascii_run;  // if not 0, non-ASCII strings alternate with runs of pure ASCII up to this long
+    uint32_t blob_min;   // binary and extension lengths have an inverse distribution in this range
+    uint32_t blob_max;
+    bool full_uint;      // whether wide unsigned integers can be above INT64_MAX
+    uint32_t nonfinite;  // 1 in this many reals are NaN or infinite (0 for none)
+} generator_profile_t;
+
+// the built-in profiles. the first is the default.
+extern const generator_profile_t generator_profiles[];
+#define GENERATOR_PROFILE_COUNT 9
+
+// Sets the profile used by object_create() and object_create_sized().
+void generator_use(const generator_profile_t* profile);
+
+// Returns the profile in use
+const generator_profile_t* generator_profile(void);
+
+// Loads a profile from a file. Each line sets a field to a value as in
+// "string_max = 200", and "base = NAME" first starts from a built-in
+// profile rather than the default. The name defaults to the file's name
+// without its directory or extension. Returns false with an error printed
+// to stderr if the file can't be read or is invalid.
+bool generator_profile_load(const char* filename, generator_profile_t* profile);
+
+// The types a format can encode natively, for generator_support(). Values of
+// other types are generated as the nearest type the format supports, so that
+// every test of a format reads and writes the same data: floats become
+// doubles, unsigned integers above INT64_MAX become doubles, non-finite reals
+// become nil, extensions become binary (the extension type followed by the
+// data) and binary becomes base64 strings.
+#define GENERATOR_SUPPORTS_FLOAT     (1 << 0)
+#define GENERATOR_SUPPORTS_BIN       (1 << 1)
+#define GENERATOR_SUPPORTS_EXT       (1 << 2)
+#define GENERATOR_SUPPORTS_UINT64    (1 << 3)
+#define GENERATOR_SUPPORTS_NONFINITE (1 << 4)
+#define GENERATOR_SUPPORTS_ALL       ((1 << 5) - 1)
+
+// Sets the types supported by the format of the objects created by
+// object_create() and object_create_sized(). The default is all of them.
+void generator_support(int types);
+
 // Generates a random object with the given arbitrary "size". This should
 // somewhat represent "real-world" data.
 //
@@ -87,9 +179,20 @@ typedef struct object_t {
 // access is on the RPi.)
 object_t* object_create(uint64_t seed, int size);
 
+// Generates a random object whose encoded size is approximately the given
+// number of bytes. The root is an array of small random objects (records,
+// in a profile with a schema), added until the estimated size of the whole
+// reaches the target. The estimate is the size in MessagePack, so other
+// formats will be somewhat bigger.
+object_t* object_create_sized(uint64_t seed, size_t bytes);
+
 // destroys the object
 void object_destroy(object_t* object);
 
+// Returns the number of nodes in the object, including itself, every
+// element of its arrays and maps, and the keys of its maps.
+size_t object_count(const object_t* object);
+
 
 #ifdef __cplusplus
 }
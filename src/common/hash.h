@@ -73,7 +73,17 @@ static inline uint32_t hash_bool(uint32_t hash, bool val) {
     return hash_u32(hash, i);
 }
 
+// Whether doubles are hashed by value (-V). This verifies that parsers and
+// printers round-trip doubles exactly, e.g. with the timeseries workload.
+extern bool hash_exact_doubles;
+
 static inline uint32_t hash_double(uint32_t hash, double val) {
+    if (hash_exact_doubles) {
+        uint64_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        return hash_u64(hash, bits);
+    }
+
     // to avoid floating point differences between different parsers and
     // architectures, we skip over floats. there are very few floats in
     // the data anyway. instead we just mix in a prime.
@@ -125,6 +135,14 @@ static inline uint32_t hash_str(uint32_t hash, const char* str, size_t len) {
     return hash;
 }
 
+static inline uint32_t hash_bin(uint32_t hash, const char* data, size_t len) {
+    return hash_str(hash, data, len);
+}
+
+static inline uint32_t hash_ext(uint32_t hash, int8_t type, const char* data, size_t len) {
+    return hash_str(hash_i8(hash, type), data, len);
+}
+
 static inline uint32_t hash_nil(uint32_t hash) {
     // don't use a simple number or string so that it can't
     // give the same hash as any other simple type
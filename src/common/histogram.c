@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "histogram.h"
+
+void histogram_clear(histogram_t* histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+void histogram_merge(histogram_t* dest, const histogram_t* src) {
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        dest->counts[i] += src->counts[i];
+    dest->total += src->total;
+    if (src->max > dest->max)
+        dest->max = src->max;
+}
+
+// returns the highest value that falls into the given bucket
+static uint64_t histogram_bucket_value(size_t bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+    int shift = (int)(bucket / HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t sub = bucket % HISTOGRAM_SUB_BUCKETS;
+    uint64_t low = (HISTOGRAM_SUB_BUCKETS + sub) << shift;
+    return low + ((UINT64_C(1) << shift) - 1);
+}
+
+uint64_t histogram_percentile(const histogram_t* histogram, double percentile) {
+    if (histogram->total == 0)
+        return 0;
+
+    uint64_t target = (uint64_t)((double)histogram->total * percentile / 100.0 + 0.5);
+    if (target < 1)
+        target = 1;
+
+    uint64_t count = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        count += histogram->counts[i];
+        if (count >= target) {
+            // the top bucket may extend beyond the largest value we've seen
+            uint64_t value = histogram_bucket_value(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
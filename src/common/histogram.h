@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_HISTOGRAM_H
+#define BENCHMARK_HISTOGRAM_H 1
+
+// A log-bucketed latency histogram in the style of HdrHistogram. Each power
+// of two is split into HISTOGRAM_SUB_BUCKETS linear sub-buckets, so any
+// recorded value can be recovered to within about 3% regardless of its
+// magnitude, in a fixed amount of memory.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct histogram_t {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} histogram_t;
+
+void histogram_clear(histogram_t* histogram);
+
+// Adds all values recorded in src into dest.
+void histogram_merge(histogram_t* dest, const histogram_t* src);
+
+// Returns (approximately) the smallest recorded value such that the given
+// percentage of all recorded values are less than or equal to it.
+uint64_t histogram_percentile(const histogram_t* histogram, double percentile);
+
+static inline size_t histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return (size_t)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HISTOGRAM_SUB_BITS;
+    size_t sub = (size_t)(value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return (size_t)(shift + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// This is called between iterations of the timed loop so it must be cheap.
+static inline void histogram_record(histogram_t* histogram, uint64_t value) {
+    ++histogram->counts[histogram_bucket(value)];
+    ++histogram->total;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// MAP_ANONYMOUS, MAP_HUGETLB and MADV_HUGEPAGE are extensions
+#define _GNU_SOURCE 1
+
+#include "hugepage.h"
+
+#ifdef __linux__
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+typedef struct region_t {
+    char* data;
+    size_t length;
+    bool used;
+} region_t;
+
+static region_t* regions;
+static size_t region_count;
+static size_t region_capacity;
+static bool use_hugetlb;
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Each thread keeps the regions it allocated (up to a few) and reuses them
+// without taking the lock, so that tests allocating and freeing buffers on
+// every iteration on several threads don't measure contention on it. They
+// stay used in the shared list until the thread gives them back when it
+// exits (or in hugepage_release() for the calling thread.)
+#define THREAD_REGIONS 16
+
+typedef struct thread_regions_t {
+    region_t regions[THREAD_REGIONS];
+    int count;
+} thread_regions_t;
+
+static __thread thread_regions_t* thread_regions;
+static pthread_key_t thread_key;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+
+static size_t round_up(size_t size) {
+    return (size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+}
+
+// Maps a region of whole huge pages. Transparent huge pages need the region
+// aligned to a huge page, so we map an extra huge page and trim both ends.
+static char* map_region(size_t length) {
+    if (use_hugetlb) {
+        void* data = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        return data == MAP_FAILED ? NULL : (char*)data;
+    }
+
+    size_t padded = length + HUGEPAGE_SIZE;
+    char* data = (char*)mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return NULL;
+    char* aligned = (char*)(((uintptr_t)data + HUGEPAGE_SIZE - 1) & ~(uintptr_t)(HUGEPAGE_SIZE - 1));
+    if (aligned > data)
+        munmap(data, (size_t)(aligned - data));
+    if (aligned + length < data + padded)
+        munmap(aligned + length, (size_t)(data + padded - (aligned + length)));
+    madvise(aligned, length, MADV_HUGEPAGE);
+    return aligned;
+}
+
+bool hugepage_init(bool* hugetlb) {
+    if (*hugetlb) {
+        // hugetlbfs only has the pages reserved in /proc/sys/vm/nr_hugepages
+        use_hugetlb = true;
+        char* probe = map_region(HUGEPAGE_SIZE);
+        if (probe) {
+            munmap(probe, HUGEPAGE_SIZE);
+            return true;
+        }
+        use_hugetlb = false;
+        *hugetlb = false;
+    }
+
+    // transparent huge pages must be enabled for madvise() or always
+    FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (!file)
+        return false;
+    char mode[64] = {0};
+    bool ok = fgets(mode, sizeof(mode), file) != NULL && strstr(mode, "[never]") == NULL;
+    fclose(file);
+    return ok;
+}
+
+// Returns this thread's regions to the shared list: those that are free
+// for any thread to reuse, and those still in use to be freed by anyone.
+static void release_thread_regions(void* data) {
+    thread_regions_t* local = (thread_regions_t*)data;
+    if (!local)
+        return;
+    pthread_mutex_lock(&region_lock);
+    for (int i = 0; i < local->count; ++i) {
+        if (local->regions[i].used)
+            continue;
+        for (size_t j = 0; j < region_count; ++j) {
+            if (regions[j].data == local->regions[i].data) {
+                regions[j].used = false;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&region_lock);
+    if (local == thread_regions) {
+        thread_regions = NULL;
+        pthread_setspecific(thread_key, NULL);
+    }
+    free(local);
+}
+
+static void create_thread_key(void) {
+    pthread_key_create(&thread_key, release_thread_regions);
+}
+
+static thread_regions_t* get_thread_regions(void) {
+    if (!thread_regions) {
+        pthread_once(&thread_key_once, create_thread_key);
+        thread_regions = (thread_regions_t*)calloc(1, sizeof(thread_regions_t));
+        if (thread_regions)
+            pthread_setspecific(thread_key, thread_regions);
+    }
+    return thread_regions;
+}
+
+// Returns this thread's region with the given data, or NULL.
+static region_t* find_thread_region(void* data) {
+    thread_regions_t* local = thread_regions;
+    if (!local)
+        return NULL;
+    for (int i = 0; i < local->count; ++i)
+        if (local->regions[i].data == data && local->regions[i].used)
+            return &local->regions[i];
+    return NULL;
+}
+
+void* hugepage_alloc(size_t size) {
+    size_t length = round_up(size == 0 ? 1 : size);
+
+    // reuse the smallest of this thread's free regions that fits
+    thread_regions_t* local = get_thread_regions();
+    if (local) {
+        region_t* best = NULL;
+        for (int i = 0; i < local->count; ++i) {
+            region_t* region = &local->regions[i];
+            if (!region->used && region->length >= length && (!best || region->length < best->length))
+                best = region;
+        }
+        if (best) {
+            best->used = true;
+            return best->data;
+        }
+    }
+
+    pthread_mutex_lock(&region_lock);
+
+    // reuse the smallest free region that fits
+    region_t* best = NULL;
+    for (size_t i = 0; i < region_count; ++i) {
+        region_t* region = &regions[i];
+        if (!region->used && region->length >= length && (!best || region->length < best->length))
+            best = region;
+    }
+    char* data = NULL;
+    if (best) {
+        best->used = true;
+        data = best->data;
+    }
+
+    if (!data && region_count == region_capacity) {
+        size_t capacity = region_capacity ? region_capacity * 2 : 16;
+        region_t* grown = (region_t*)realloc(regions, capacity * sizeof(region_t));
+        if (!grown) {
+            pthread_mutex_unlock(&region_lock);
+            return NULL;
+        }
+        regions = grown;
+        region_capacity = capacity;
+    }
+    if (!data) {
+        data = map_region(length);
+        if (data) {
+            regions[region_count] = (region_t){data, length, true};
+            ++region_count;
+        }
+    }
+    region_t region = {data, best ? best->length : length, true};
+    pthread_mutex_unlock(&region_lock);
+
+    // keep it for this thread if there's room
+    if (data && local && local->count < THREAD_REGIONS)
+        local->regions[local->count++] = region;
+    return data;
+}
+
+// Returns the length of a used region, or 0 if the data isn't a region.
+static size_t region_length(void* data) {
+    region_t* region = find_thread_region(data);
+    if (region)
+        return region->length;
+    pthread_mutex_lock(&region_lock);
+    size_t length = 0;
+    for (size_t i = 0; i < region_count; ++i) {
+        if (regions[i].data == data && regions[i].used) {
+            length = regions[i].length;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&region_lock);
+    return length;
+}
+
+void* hugepage_realloc(void* data, size_t size) {
+    if (!data)
+        return hugepage_alloc(size);
+    size_t length = region_length(data);
+    if (length >= size)
+        return data;
+    void* new_data = hugepage_alloc(size);
+    if (!new_data)
+        return NULL;
+    memcpy(new_data, data, length);
+    hugepage_free(data);
+    return new_data;
+}
+
+bool hugepage_free(void* data) {
+    region_t* region = find_thread_region(data);
+    if (region) {
+        region->used = false;
+        return true;
+    }
+    pthread_mutex_lock(&region_lock);
+    bool found = false;
+    for (size_t i = 0; i < region_count; ++i) {
+        if (regions[i].data == data && regions[i].used) {
+            regions[i].used = false;
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&region_lock);
+    return found;
+}
+
+void hugepage_release(void) {
+    release_thread_regions(thread_regions);
+    pthread_mutex_lock(&region_lock);
+    size_t kept = 0;
+    for (size_t i = 0; i < region_count; ++i) {
+        if (regions[i].used)
+            regions[kept++] = regions[i];
+        else
+            munmap(regions[i].data, regions[i].length);
+    }
+    region_count = kept;
+    pthread_mutex_unlock(&region_lock);
+}
+
+long hugepage_resident(void) {
+    FILE* file = fopen("/proc/self/smaps_rollup", "r");
+    if (!file)
+        return -1;
+    long total = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), file)) {
+        long kb;
+        if (sscanf(line, "AnonHugePages: %li kB", &kb) == 1 ||
+                sscanf(line, "Shared_Hugetlb: %li kB", &kb) == 1 ||
+                sscanf(line, "Private_Hugetlb: %li kB", &kb) == 1)
+            total += kb;
+    }
+    fclose(file);
+    return total;
+}
+
+#else
+
+bool hugepage_init(bool* hugetlb) {
+    *hugetlb = false;
+    return false;
+}
+
+void* hugepage_alloc(size_t size) {
+    (void)size;
+    return NULL;
+}
+
+void* hugepage_realloc(void* data, size_t size) {
+    (void)data;
+    (void)size;
+    return NULL;
+}
+
+bool hugepage_free(void* data) {
+    (void)data;
+    return false;
+}
+
+void hugepage_release(void) {
+}
+
+long hugepage_resident(void) {
+    return -1;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_HUGEPAGE_H
+#define BENCHMARK_HUGEPAGE_H 1
+
+// Buffers backed by 2 MB huge pages, either transparent huge pages advised
+// with madvise() or pages reserved in hugetlbfs. Mapping and faulting in
+// huge pages is far slower than malloc(), so freed buffers are cached and
+// reused rather than unmapped; after the first few iterations of a test,
+// allocating a buffer costs about as much as malloc(). Each thread caches
+// its own buffers without locking, so a buffer should be freed on the
+// thread that allocated it.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HUGEPAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+// Enables huge page buffers, from hugetlbfs if requested or otherwise
+// transparent huge pages. Returns false if neither is available. If
+// hugetlbfs has no free pages this falls back to transparent huge pages
+// and clears *hugetlb.
+bool hugepage_init(bool* hugetlb);
+
+// Allocates a buffer of at least the given size aligned to a huge page.
+// Returns NULL if out of memory.
+void* hugepage_alloc(size_t size);
+
+// Grows or shrinks a buffer allocated by hugepage_alloc(). This is free if
+// the buffer's pages are already big enough.
+void* hugepage_realloc(void* data, size_t size);
+
+// Frees a buffer allocated by hugepage_alloc(), keeping its pages for
+// reuse. Returns false if the data isn't a huge page buffer.
+bool hugepage_free(void* data);
+
+// Unmaps all free buffers, including those cached by the calling thread.
+// Other threads give theirs back when they exit.
+void hugepage_release(void);
+
+// Returns the memory of the process (in KB) that's backed by huge pages,
+// whether ours or malloc()'s, or -1 if not known.
+long hugepage_resident(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// MAP_POPULATE and MADV_HUGEPAGE are Linux extensions
+#define _GNU_SOURCE 1
+
+#include "mapfile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct mapping_t {
+    char* data;
+    size_t length;
+} mapping_t;
+
+static mapping_t* mappings;
+static size_t mapping_count;
+static size_t mapping_capacity;
+
+static const char* protect_name;
+static bool hugepage_warned;
+
+bool mapfile_available(void) {
+    return true;
+}
+
+char* mapfile_open(const char* filename, size_t* size_out, int flags) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+
+    // We reserve the file size plus one byte rounded up to whole pages of
+    // anonymous zeroed memory, and map the file over the start of it. The
+    // tail of the file's last page is zero-filled by the kernel, and if the
+    // file ends on a page boundary the next page is the anonymous one, so
+    // the data is always null-terminated.
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = (size + 1 + page - 1) & ~(page - 1);
+    char* data = (char*)mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    if (size > 0) {
+        int map_flags = MAP_PRIVATE | MAP_FIXED;
+        #ifdef MAP_POPULATE
+        if (flags & MAPFILE_POPULATE)
+            map_flags |= MAP_POPULATE;
+        #endif
+        if (mmap(data, size, PROT_READ, map_flags, fd, 0) == MAP_FAILED) {
+            munmap(data, length);
+            close(fd);
+            return NULL;
+        }
+    }
+    close(fd);
+
+    #ifdef MADV_HUGEPAGE
+    // huge pages for file mappings need a kernel with transparent huge
+    // pages for the page cache, so this is often refused
+    if ((flags & MAPFILE_HUGEPAGE) && madvise(data, length, MADV_HUGEPAGE) != 0 && !hugepage_warned) {
+        fprintf(stderr, "note: huge pages are not available for mapped files\n");
+        hugepage_warned = true;
+    }
+    #endif
+    if (flags & MAPFILE_SEQUENTIAL)
+        madvise(data, length, MADV_SEQUENTIAL);
+
+    if (mapping_count == mapping_capacity) {
+        size_t capacity = mapping_capacity ? mapping_capacity * 2 : 8;
+        mapping_t* grown = (mapping_t*)realloc(mappings, capacity * sizeof(mapping_t));
+        if (!grown) {
+            munmap(data, length);
+            return NULL;
+        }
+        mappings = grown;
+        mapping_capacity = capacity;
+    }
+    mappings[mapping_count].data = data;
+    mappings[mapping_count].length = length;
+    ++mapping_count;
+
+    *size_out = size;
+    return data;
+}
+
+bool mapfile_close(char* data) {
+    for (size_t i = 0; i < mapping_count; ++i) {
+        if (mappings[i].data == data) {
+            munmap(data, mappings[i].length);
+            mappings[i] = mappings[--mapping_count];
+            if (mapping_count == 0) {
+                free(mappings);
+                mappings = NULL;
+                mapping_capacity = 0;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mapfile_owns(const void* address) {
+    const char* p = (const char*)address;
+    for (size_t i = 0; i < mapping_count; ++i)
+        if (p >= mappings[i].data && p < mappings[i].data + mappings[i].length)
+            return true;
+    return false;
+}
+
+static void write_string(const char* str) {
+    ssize_t unused = write(STDERR_FILENO, str, strlen(str));
+    (void)unused;
+}
+
+static void segv_handler(int signal, siginfo_t* info, void* context) {
+    (void)context;
+    if (mapfile_owns(info->si_addr)) {
+        // only async-signal-safe calls from here
+        write_string(protect_name);
+        write_string(": the library wrote to its read-only input!\n");
+        _exit(EXIT_FAILURE);
+    }
+
+    // not ours; crash as we would have without the handler
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigaction(signal, &action, NULL);
+    raise(signal);
+}
+
+void mapfile_protect(const char* name) {
+    protect_name = name;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = segv_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+}
+
+#else
+
+bool mapfile_available(void) {
+    return false;
+}
+
+char* mapfile_open(const char* filename, size_t* size_out, int flags) {
+    (void)filename;
+    (void)size_out;
+    (void)flags;
+    return NULL;
+}
+
+bool mapfile_close(char* data) {
+    (void)data;
+    return false;
+}
+
+bool mapfile_owns(const void* address) {
+    (void)address;
+    return false;
+}
+
+void mapfile_protect(const char* name) {
+    (void)name;
+}
+
+#endif
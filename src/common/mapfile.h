@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_MAPFILE_H
+#define BENCHMARK_MAPFILE_H 1
+
+// Read-only memory mapping of data files. A mapped file is followed by at
+// least one zero byte, so that parsers that need null-terminated input can
+// parse it in place. Any attempt to write to a mapping faults; a handler can
+// be installed to report this as a library writing to its input.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pre-faults the whole file when it's mapped (MAP_POPULATE)
+#define MAPFILE_POPULATE   (1 << 0)
+
+// Advises the kernel to back the mapping with huge pages (MADV_HUGEPAGE)
+#define MAPFILE_HUGEPAGE   (1 << 1)
+
+// Advises the kernel that the mapping will be read in order (MADV_SEQUENTIAL)
+#define MAPFILE_SEQUENTIAL (1 << 2)
+
+// Whether memory mapping is supported on this platform.
+bool mapfile_available(void);
+
+// Maps a file read-only with the given MAPFILE_* flags. Returns NULL if the
+// file can't be opened or mapped.
+char* mapfile_open(const char* filename, size_t* size_out, int flags);
+
+// Unmaps a file mapped by mapfile_open(). Returns false if the data isn't a
+// mapping.
+bool mapfile_close(char* data);
+
+// Returns true if the address is within a mapped file.
+bool mapfile_owns(const void* address);
+
+// Installs a handler that reports a write to a mapped file, prefixed by the
+// given name, and exits rather than crashing.
+void mapfile_protect(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
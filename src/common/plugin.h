@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// The plugin interface between tests and the plugin runner. Each test can
+// be built as a shared object along with plugin.c, which exports the test
+// functions in a benchmark_plugin_t. The runner (runner.c) loads these and
+// runs them through the harness in a single process.
+
+#ifndef BENCHMARK_PLUGIN_H
+#define BENCHMARK_PLUGIN_H 1
+
+#include "benchmark.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct benchmark_plugin_t {
+    bool (*is_benchmark)(void);
+    bool (*run_test)(uint32_t* hash_out);
+    bool (*setup_test)(size_t object_size);
+    void (*teardown_test)(void);
+    const char* (*test_language)(void);
+    const char* (*test_version)(void);
+    const char* (*test_format)(void);
+    const char* (*test_filename)(void);
+} benchmark_plugin_t;
+
+// The symbol exported by each plugin
+#define BENCHMARK_PLUGIN_SYMBOL "benchmark_plugin"
+extern const benchmark_plugin_t benchmark_plugin;
+
+/**
+ * The harness functions used by the runner. These are also used by the
+ * main() of the individual test executables.
+ */
+
+// Parses the harness option at argv[0]. Returns the number of arguments
+// consumed, 0 if the option is not a harness option, or -1 on error.
+int benchmark_parse_option(const char* name, int argc, char** argv);
+
+// Parses an object size: a size class in the range [1,5], or a target
+// encoded size in bytes with an optional K, M or G suffix (e.g. 64K). A
+// size with a suffix is always in bytes, so "3B" is rejected rather than
+// taken as size class 3.
+bool benchmark_parse_size(const char* arg, size_t* object_size);
+
+// Returns true if the harness should print only the time per iteration (-r)
+bool benchmark_result_only(void);
+
+// Prepares memory before running tests, and cleans up afterwards.
+bool benchmark_begin(const char* name);
+void benchmark_end(void);
+
+// Runs a test at the given object size. This runs the test's setup, the
+// benchmark itself, and its teardown, and writes the result.
+bool benchmark_run(const benchmark_plugin_t* plugin, const char* name,
+        size_t binary_size, size_t object_size);
+
+// Compares two variants of a test (e.g. built with and without a flag) at
+// the given object size. Both are set up together and run in alternating
+// batches on the same thread, and the relative difference of B from A is
+// printed along with its confidence interval and significance.
+bool benchmark_compare(const benchmark_plugin_t* plugin_a, const char* name_a,
+        const benchmark_plugin_t* plugin_b, const char* name_b, size_t object_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// we need dladdr() and realpath()
+#define _GNU_SOURCE 1
+
+#include "profiler.h"
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#define PROFILER_DEPTH 64
+#define PROFILER_MAX_SAMPLES 16384 // about 16 seconds at PROFILER_HZ
+
+// backtrace() from the handler starts with the handler itself and the
+// signal trampoline, which we skip
+#define PROFILER_SKIP 2
+
+typedef struct sample_t {
+    int depth;
+    void* frames[PROFILER_DEPTH];
+} sample_t;
+
+static sample_t* samples;
+static int sample_count; // may exceed PROFILER_MAX_SAMPLES; the rest are dropped
+
+static void profiler_handler(int signal) {
+    (void)signal;
+    int index = __atomic_fetch_add(&sample_count, 1, __ATOMIC_RELAXED);
+    if (index >= PROFILER_MAX_SAMPLES)
+        return;
+    int saved_errno = errno;
+    samples[index].depth = backtrace(samples[index].frames, PROFILER_DEPTH);
+    errno = saved_errno;
+}
+
+bool profiler_init(void) {
+    samples = (sample_t*)calloc(PROFILER_MAX_SAMPLES, sizeof(sample_t));
+    if (!samples)
+        return false;
+
+    // the first call to backtrace() loads the unwinder, which isn't safe
+    // in a signal handler, so we make it here
+    void* frames[4];
+    backtrace(frames, 4);
+    return true;
+}
+
+void profiler_start(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = profiler_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / PROFILER_HZ;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+void profiler_stop(void) {
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_IGN);
+}
+
+static int compare_samples(const void* left, const void* right) {
+    const sample_t* a = (const sample_t*)left;
+    const sample_t* b = (const sample_t*)right;
+    if (a->depth != b->depth)
+        return a->depth < b->depth ? -1 : 1;
+    return memcmp(a->frames, b->frames, a->depth * sizeof(void*));
+}
+
+static void write_frame(FILE* file, void* address) {
+    // dladdr() gives the path the module was loaded as, which may be
+    // relative, so we resolve it (once per module, since they repeat)
+    static const char* last_module;
+    static char last_path[PATH_MAX];
+    Dl_info info;
+    if (!dladdr(address, &info) || !info.dli_fname || !info.dli_fbase) {
+        fprintf(file, "0x%" PRIxPTR, (uintptr_t)address);
+        return;
+    }
+    if (info.dli_fname != last_module) {
+        if (!realpath(info.dli_fname, last_path)) {
+            strncpy(last_path, info.dli_fname, sizeof(last_path) - 1);
+            last_path[sizeof(last_path) - 1] = '\0';
+        }
+        last_module = info.dli_fname;
+    }
+    fprintf(file, "%s+0x%" PRIxPTR, last_path, (uintptr_t)address - (uintptr_t)info.dli_fbase);
+}
+
+int profiler_write(const char* filename, int* dropped) {
+    int count = sample_count < PROFILER_MAX_SAMPLES ? sample_count : PROFILER_MAX_SAMPLES;
+    *dropped = sample_count - count;
+    sample_count = 0;
+
+    FILE* file = fopen(filename, "w");
+    if (!file)
+        return -1;
+
+    // identical stacks are adjacent once sorted
+    qsort(samples, count, sizeof(sample_t), compare_samples);
+    for (int i = 0; i < count; ) {
+        int j = i + 1;
+        while (j < count && compare_samples(&samples[i], &samples[j]) == 0)
+            ++j;
+        const sample_t* sample = &samples[i];
+        bool first = true;
+        for (int frame = sample->depth - 1; frame >= PROFILER_SKIP; --frame) {
+            if (!first)
+                fputc(';', file);
+            write_frame(file, sample->frames[frame]);
+            first = false;
+        }
+        if (!first)
+            fprintf(file, " %i\n", j - i);
+        i = j;
+    }
+
+    fclose(file);
+    return count;
+}
+
+void profiler_destroy(void) {
+    free(samples);
+    samples = NULL;
+}
+
+#else
+
+bool profiler_init(void) {
+    return false;
+}
+
+void profiler_start(void) {
+}
+
+void profiler_stop(void) {
+}
+
+int profiler_write(const char* filename, int* dropped) {
+    (void)filename;
+    *dropped = 0;
+    return -1;
+}
+
+void profiler_destroy(void) {
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_PROFILER_H
+#define BENCHMARK_PROFILER_H 1
+
+// A sampling profiler. While it's running, a SIGPROF timer interrupts the
+// process about PROFILER_HZ times per second of CPU time (on any thread)
+// and records the call stack. The stacks are written as folded stacks: one
+// line per distinct stack, with the frames from the root down separated by
+// semicolons, followed by the number of samples. Each frame is the path of
+// its executable or shared object and an offset ("path+0x1234"), since the
+// tests are stripped; tools/fold.py symbolizes them against the unstripped
+// build/<test>.debug executables for flame graphs.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROFILER_HZ 997 // prime so as not to alias with periodic work
+
+// Allocates the sample buffer. This must be called before the memory
+// baseline, and returns false if profiling isn't supported.
+bool profiler_init(void);
+
+// Starts and stops sampling. Samples accumulate until written.
+void profiler_start(void);
+void profiler_stop(void);
+
+// Writes the samples as folded stacks and clears them. Returns the number
+// of samples written, or -1 if the file can't be written. Samples beyond
+// the size of the buffer are dropped and counted in *dropped.
+int profiler_write(const char* filename, int* dropped);
+
+// Frees the sample buffer.
+void profiler_destroy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// The plugin runner loads tests built as shared objects (see plugin.h) and
+// runs them all in a single process. Tests are run in interleaved rounds
+// (ABAB rather than AABB) so that drift in temperature and clock frequency
+// over the course of a run affects all tests equally.
+//
+// Usage: build/runner [options] sizes...
+//
+// The options are those of the harness (see benchmark.c), plus:
+//   -n name      only run tests whose name contains this (can be repeated)
+//   -k category  only run tests in this category (can be repeated)
+//   -R rounds    run this many interleaved rounds (default 1)
+//   -A a b       compare test b against test a in paired batches instead
+//                (see benchmark_compare() in plugin.h)
+
+#define _GNU_SOURCE 1
+#include "plugin.h"
+
+#include <dlfcn.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define PLUGIN_DIR "build/plugins"
+#define PLUGIN_SUFFIX ".so"
+#define PLUGIN_MAX 128
+#define FILTER_MAX 32
+#define SIZE_MAX_COUNT 32
+
+// Tests are categorized by the suffix of their name.
+typedef struct category_t {
+    const char* suffix;
+    const char* category;
+} category_t;
+
+static const category_t categories[] = {
+    {"-write",   "write"},
+    {"-pack",    "write"},
+    {"-gen",     "write"},
+    {"-dump",    "write"},
+    {"-append",  "write"},
+    {"-builder", "write"},
+    {"-node",    "tree"},
+    {"-dom",     "tree"},
+    {"-tree",    "tree"},
+    {"-load",    "tree"},
+    {"-unpack",  "tree"},
+    {"-obj",     "tree"},
+    {"-parser",  "tree"},
+    {"-read",    "incremental"},
+    {"-sax",     "incremental"},
+    {"-parse",   "incremental"},
+    {"-iter",    "incremental"},
+    {"-file",    "file"},
+};
+
+static const char* category(const char* name) {
+    if (strncmp(name, "hash-", 5) == 0)
+        return "hash";
+    size_t length = strlen(name);
+    for (size_t i = 0; i < sizeof(categories) / sizeof(*categories); ++i) {
+        size_t suffix_length = strlen(categories[i].suffix);
+        if (length > suffix_length && strcmp(name + length - suffix_length, categories[i].suffix) == 0)
+            return categories[i].category;
+    }
+    return "other";
+}
+
+typedef struct test_t {
+    char name[64];
+    const benchmark_plugin_t* plugin;
+    size_t binary_size;
+} test_t;
+
+static int name_filter_count;
+static const char* name_filters[FILTER_MAX];
+static int category_filter_count;
+static const char* category_filters[FILTER_MAX];
+
+static bool matches(const char* name) {
+    bool match = name_filter_count == 0;
+    for (int i = 0; i < name_filter_count; ++i)
+        if (strstr(name, name_filters[i]))
+            match = true;
+    if (!match)
+        return false;
+
+    if (category_filter_count == 0)
+        return true;
+    for (int i = 0; i < category_filter_count; ++i)
+        if (strcmp(category(name), category_filters[i]) == 0)
+            return true;
+    return false;
+}
+
+static int compare_names(const void* left, const void* right) {
+    return strcmp(((const test_t*)left)->name, ((const test_t*)right)->name);
+}
+
+// Loads the plugin for the named test. Returns 1 if it was loaded, 0 if it
+// isn't a benchmark (the file creators), or -1 on error.
+static int load_test(const char* runner, test_t* test) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s%s", PLUGIN_DIR, test->name, PLUGIN_SUFFIX);
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "%s: failed to load %s: %s\n", runner, path, dlerror());
+        return -1;
+    }
+    test->plugin = (const benchmark_plugin_t*)dlsym(handle, BENCHMARK_PLUGIN_SYMBOL);
+    if (!test->plugin) {
+        fprintf(stderr, "%s: %s is not a benchmark plugin\n", runner, path);
+        dlclose(handle);
+        return -1;
+    }
+    if (!test->plugin->is_benchmark()) {
+        dlclose(handle);
+        return 0;
+    }
+
+    // the code size is that of the stripped test executable, which
+    // is built from the same objects as the plugin (plus the harness)
+    char executable[256];
+    snprintf(executable, sizeof(executable), "build/%s", test->name);
+    struct stat st;
+    test->binary_size = 0;
+    if (stat(executable, &st) == 0)
+        test->binary_size = st.st_size;
+    else
+        fprintf(stderr, "%s: %s is missing; its code size will be 0\n", runner, executable);
+    return 1;
+}
+
+// Loads the plugins matching the filters.
+static int load_tests(const char* runner, test_t* tests) {
+    DIR* dir = opendir(PLUGIN_DIR);
+    if (!dir) {
+        fprintf(stderr, "%s: no plugins found in %s. did you make build-plugins?\n", runner, PLUGIN_DIR);
+        return -1;
+    }
+
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        size_t suffix_length = strlen(PLUGIN_SUFFIX);
+        if (length <= suffix_length || strcmp(entry->d_name + length - suffix_length, PLUGIN_SUFFIX) != 0)
+            continue;
+        if (count == PLUGIN_MAX) {
+            fprintf(stderr, "%s: too many plugins!\n", runner);
+            break;
+        }
+
+        test_t* test = &tests[count];
+        if (length - suffix_length >= sizeof(test->name))
+            continue;
+        memcpy(test->name, entry->d_name, length - suffix_length);
+        test->name[length - suffix_length] = '\0';
+        if (!matches(test->name))
+            continue;
+
+        int loaded = load_test(runner, test);
+        if (loaded < 0) {
+            closedir(dir);
+            return -1;
+        }
+        count += loaded;
+    }
+    closedir(dir);
+
+    qsort(tests, count, sizeof(*tests), compare_names);
+    return count;
+}
+
+// Loads the two variants to compare by name.
+static bool load_variants(const char* runner, test_t* variants, const char* name_a, const char* name_b) {
+    // the same plugin loaded twice would share its test's state
+    if (strcmp(name_a, name_b) == 0) {
+        fprintf(stderr, "%s: can't compare %s with itself\n", runner, name_a);
+        return false;
+    }
+    const char* names[2] = {name_a, name_b};
+    for (int i = 0; i < 2; ++i) {
+        if (strlen(names[i]) >= sizeof(variants[i].name)) {
+            fprintf(stderr, "%s: test name %s is too long\n", runner, names[i]);
+            return false;
+        }
+        strcpy(variants[i].name, names[i]);
+        int loaded = load_test(runner, &variants[i]);
+        if (loaded == 0)
+            fprintf(stderr, "%s: %s is not a benchmark\n", runner, names[i]);
+        if (loaded <= 0)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* runner = argv[0];
+    ++argv;
+    --argc;
+
+    int rounds = 1;
+    const char* compare_a = NULL;
+    const char* compare_b = NULL;
+    while (argc >= 1 && argv[0][0] == '-') {
+        int count;
+        if (strcmp(argv[0], "-n") == 0 && argc >= 2 && name_filter_count < FILTER_MAX) {
+            name_filters[name_filter_count++] = argv[1];
+            count = 2;
+        } else if (strcmp(argv[0], "-k") == 0 && argc >= 2 && category_filter_count < FILTER_MAX) {
+            category_filters[category_filter_count++] = argv[1];
+            count = 2;
+        } else if (strcmp(argv[0], "-R") == 0 && argc >= 2) {
+            rounds = atoi(argv[1]);
+            if (rounds < 1) {
+                fprintf(stderr, "%s: rounds must be at least 1\n", runner);
+                return EXIT_FAILURE;
+            }
+            count = 2;
+        } else if (strcmp(argv[0], "-A") == 0 && argc >= 3) {
+            compare_a = argv[1];
+            compare_b = argv[2];
+            count = 3;
+        } else {
+            count = benchmark_parse_option(runner, argc, argv);
+            if (count == 0)
+                fprintf(stderr, "%s: unrecognized option %s\n", runner, argv[0]);
+            if (count <= 0)
+                return EXIT_FAILURE;
+        }
+        argv += count;
+        argc -= count;
+    }
+
+    // need sizes
+    if (argc == 0) {
+        fprintf(stderr, "%s: object sizes in the range [1,5] (or target sizes "
+                "in bytes) must be provided as command-line arguments\n", runner);
+        return EXIT_FAILURE;
+    }
+    size_t sizes[SIZE_MAX_COUNT];
+    int size_count = 0;
+    for (; argc > 0; --argc, ++argv) {
+        if (size_count == SIZE_MAX_COUNT) {
+            fprintf(stderr, "%s: too many sizes!\n", runner);
+            return EXIT_FAILURE;
+        }
+        if (!benchmark_parse_size(argv[0], &sizes[size_count++])) {
+            fprintf(stderr, "%s: object sizes must be in the range [1,5], or a target size "
+                    "in bytes up to 1G (e.g. 700 or 64K)\n", runner);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (compare_a) {
+        test_t variants[2];
+        if (!load_variants(runner, variants, compare_a, compare_b))
+            return EXIT_FAILURE;
+        if (!benchmark_begin(runner))
+            return EXIT_FAILURE;
+        for (int round = 0; round < rounds; ++round)
+            for (int i = 0; i < size_count; ++i)
+                if (!benchmark_compare(variants[0].plugin, variants[0].name,
+                            variants[1].plugin, variants[1].name, sizes[i]))
+                    return EXIT_FAILURE;
+        benchmark_end();
+        return EXIT_SUCCESS;
+    }
+
+    static test_t tests[PLUGIN_MAX];
+    int test_count = load_tests(runner, tests);
+    if (test_count < 0)
+        return EXIT_FAILURE;
+    if (test_count == 0) {
+        fprintf(stderr, "%s: no tests match\n", runner);
+        return EXIT_FAILURE;
+    }
+    if (!benchmark_result_only()) {
+        for (int i = 0; i < test_count; ++i)
+            printf("%s: %s (%s), executable size: %i bytes\n", runner, tests[i].name,
+                    category(tests[i].name), (int)tests[i].binary_size);
+    }
+
+    if (!benchmark_begin(runner))
+        return EXIT_FAILURE;
+    for (int round = 0; round < rounds; ++round) {
+        if (!benchmark_result_only())
+            printf("%s: round %i of %i\n", runner, round + 1, rounds);
+        for (int i = 0; i < size_count; ++i)
+            for (int j = 0; j < test_count; ++j)
+                if (!benchmark_run(tests[j].plugin, tests[j].name, tests[j].binary_size, sizes[i]))
+                    return EXIT_FAILURE;
+    }
+    benchmark_end();
+
+    // plugins are left loaded; the process is about to exit anyway
+    return EXIT_SUCCESS;
+}
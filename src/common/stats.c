@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "stats.h"
+
+#include <math.h>
+
+double stats_stdev(const stats_t* stats) {
+    if (stats->count < 2)
+        return 0;
+    return sqrt(stats->m2 / (stats->count - 1));
+}
+
+double stats_ci(const stats_t* stats) {
+    if (stats->count < 2)
+        return INFINITY;
+    return stats_t_critical(stats->count - 1) * stats_stdev(stats) / sqrt((double)stats->count);
+}
+
+double stats_t_critical(int degrees_of_freedom) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    if (degrees_of_freedom < 1)
+        return INFINITY;
+    if (degrees_of_freedom <= (int)(sizeof(table) / sizeof(*table)))
+        return table[degrees_of_freedom - 1];
+    if (degrees_of_freedom <= 60)
+        return 2.000;
+    if (degrees_of_freedom <= 120)
+        return 1.980;
+    return 1.960;
+}
+
+// xorshift64*, so that the bootstrap doesn't disturb or depend on rand()
+static uint64_t stats_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+static int compare_doubles(const void* left, const void* right) {
+    double l = *(const double*)left;
+    double r = *(const double*)right;
+    return (l > r) - (l < r);
+}
+
+bool stats_bootstrap_ci(const double* samples, int count, int resamples,
+        double* low, double* high)
+{
+    double* means = (double*)malloc(resamples * sizeof(double));
+    if (!means)
+        return false;
+
+    uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+    for (int i = 0; i < resamples; ++i) {
+        double sum = 0;
+        for (int j = 0; j < count; ++j)
+            sum += samples[stats_random(&state) % (uint64_t)count];
+        means[i] = sum / count;
+    }
+
+    qsort(means, resamples, sizeof(double), compare_doubles);
+    *low = means[(int)(0.025 * (resamples - 1))];
+    *high = means[(int)(0.975 * (resamples - 1))];
+    free(means);
+    return true;
+}
+
+double stats_wilcoxon(const double* differences, int count) {
+    double* magnitudes = (double*)malloc(count * sizeof(double));
+    if (!magnitudes)
+        return 1;
+    int n = 0;
+    for (int i = 0; i < count; ++i)
+        if (differences[i] != 0)
+            magnitudes[n++] = fabs(differences[i]);
+    if (n == 0) {
+        free(magnitudes);
+        return 1;
+    }
+    qsort(magnitudes, n, sizeof(double), compare_doubles);
+
+    // sum the ranks of the positive differences. tied magnitudes get the
+    // average of their ranks, which we find by binary search in the sorted
+    // magnitudes.
+    double positive_ranks = 0;
+    for (int i = 0; i < count; ++i) {
+        if (differences[i] <= 0)
+            continue;
+        double magnitude = differences[i];
+        int first = 0, last = n;
+        while (first < last) {
+            int middle = (first + last) / 2;
+            if (magnitudes[middle] < magnitude)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        int end = first;
+        while (end < n && magnitudes[end] == magnitude)
+            ++end;
+        positive_ranks += (first + 1 + end) / 2.0;
+    }
+
+    // the variance of the rank sum, less a correction for each group of ties
+    double variance = n * (n + 1.0) * (2.0 * n + 1.0) / 24.0;
+    for (int i = 0; i < n;) {
+        int end = i + 1;
+        while (end < n && magnitudes[end] == magnitudes[i])
+            ++end;
+        double ties = end - i;
+        variance -= (ties * ties * ties - ties) / 48.0;
+        i = end;
+    }
+    free(magnitudes);
+    if (variance <= 0)
+        return 1;
+
+    double z = (positive_ranks - n * (n + 1.0) / 4.0) / sqrt(variance);
+    return erfc(fabs(z) / sqrt(2.0));
+}
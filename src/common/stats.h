@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Running statistics for the benchmarking framework.
+
+#ifndef BENCHMARK_STATS_H
+#define BENCHMARK_STATS_H 1
+
+#include "platform.h"
+
+// The running mean and variance of a series of samples, using Welford's
+// algorithm so that no samples need to be kept.
+typedef struct stats_t {
+    int count;
+    double mean;
+    double m2;  // sum of squared differences from the mean
+} stats_t;
+
+static inline void stats_clear(stats_t* stats) {
+    stats->count = 0;
+    stats->mean = 0;
+    stats->m2 = 0;
+}
+
+static inline void stats_add(stats_t* stats, double sample) {
+    ++stats->count;
+    double delta = sample - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (sample - stats->mean);
+}
+
+// Returns the sample standard deviation.
+double stats_stdev(const stats_t* stats);
+
+// Returns the half-width of the 95% confidence interval of the mean, or
+// infinity if there are fewer than two samples.
+double stats_ci(const stats_t* stats);
+
+// Returns the two-sided 95% critical value of Student's t distribution.
+double stats_t_critical(int degrees_of_freedom);
+
+// Computes a 95% bootstrap confidence interval of the mean of the given
+// samples by resampling them with replacement. The resampling uses a fixed
+// seed so the result is reproducible. Returns false if out of memory.
+bool stats_bootstrap_ci(const double* samples, int count, int resamples,
+        double* low, double* high);
+
+// Returns the two-sided p-value of the Wilcoxon signed-rank test that the
+// given paired differences are centred on zero. This uses the normal
+// approximation (with a correction for ties), which is accurate enough for
+// the dozens of pairs or more that we collect. Zero differences are dropped.
+// Returns 1 if there are no non-zero differences or if out of memory.
+double stats_wilcoxon(const double* differences, int count);
+
+#endif
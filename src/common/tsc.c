@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tsc.h"
+
+// calibrate over this many nanoseconds
+#define CALIBRATION_TIME 100000000
+#define OVERHEAD_SAMPLES 10000
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <cpuid.h>
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+bool tsc_available(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    // RDTSCP is CPUID 0x80000001 EDX bit 27, and the invariant TSC is
+    // CPUID 0x80000007 EDX bit 8
+    if (__get_cpuid_max(0x80000000, NULL) < 0x80000007)
+        return false;
+    if (!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 27)))
+        return false;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (edx & (1u << 8)) != 0;
+}
+
+double tsc_calibrate(void) {
+    // spin rather than sleep so the core doesn't drop into a power state
+    // that might take a while to leave
+    uint64_t start_ns = monotonic_ns();
+    uint64_t start = tsc_start();
+    uint64_t end_ns;
+    do {
+        end_ns = monotonic_ns();
+    } while (end_ns - start_ns < CALIBRATION_TIME);
+    uint64_t end = tsc_stop();
+    return (double)(end - start) / (double)(end_ns - start_ns);
+}
+
+uint64_t tsc_overhead(void) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < OVERHEAD_SAMPLES; ++i) {
+        uint64_t start = tsc_start();
+        uint64_t time = tsc_stop() - start;
+        if (time < best)
+            best = time;
+    }
+    return best;
+}
+
+#else
+
+bool tsc_available(void) {return false;}
+double tsc_calibrate(void) {return 0;}
+uint64_t tsc_overhead(void) {return 0;}
+
+#endif
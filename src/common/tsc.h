@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016 Nicholas Fraser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_TSC_H
+#define BENCHMARK_TSC_H 1
+
+// Cycle-accurate timing with the x86 time stamp counter. The TSC is read
+// with serializing fences so that the timed code can't be reordered across
+// the reads: LFENCE before RDTSC waits for earlier instructions to finish,
+// and RDTSCP followed by LFENCE waits for the timed code to finish and
+// keeps later instructions from starting early. The TSC is only usable if
+// it is invariant, i.e. it ticks at a constant rate regardless of the
+// clock speed and power state of the core.
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+
+static inline uint64_t tsc_start(void) {
+    uint32_t low, high;
+    __asm__ __volatile__ ("lfence\n\trdtsc" : "=a" (low), "=d" (high) :: "memory");
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline uint64_t tsc_stop(void) {
+    uint32_t low, high;
+    __asm__ __volatile__ ("rdtscp\n\tlfence" : "=a" (low), "=d" (high) :: "ecx", "memory");
+    return ((uint64_t)high << 32) | low;
+}
+
+#else
+
+static inline uint64_t tsc_start(void) {return 0;}
+static inline uint64_t tsc_stop(void) {return 0;}
+
+#endif
+
+// Returns true if the CPU has an invariant TSC.
+bool tsc_available(void);
+
+// Measures the TSC frequency against CLOCK_MONOTONIC, in ticks per
+// nanosecond.
+double tsc_calibrate(void);
+
+// Measures the overhead of a tsc_start()/tsc_stop() pair around no code,
+// in ticks. This is subtracted from each timed iteration.
+uint64_t tsc_overhead(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
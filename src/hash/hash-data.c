@@ -36,9 +36,12 @@ bool setup_test(size_t object_size) {
     // time for flat data is nearly insignificant. we're just interested in
     // including the hash code (and object generation code and all other code in
     // benchmark.c) so its compiled size can be subtracted out of the results.
-    hash_size = 100;
-    for (size_t i = 0; i < object_size; ++i)
-        hash_size <<= 3;
+    hash_size = object_size;
+    if (object_size <= BENCHMARK_SIZE_MAX) {
+        hash_size = 100;
+        for (size_t i = 0; i < object_size; ++i)
+            hash_size <<= 3;
+    }
 
     srand(123);
     hash_data = (char*)malloc(hash_size);
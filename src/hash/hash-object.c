@@ -33,23 +33,17 @@ static void hash_object(object_t* object, uint32_t* hash) {
         case type_int:    *hash = hash_i64(*hash, object->i); return;
         case type_uint:   *hash = hash_u64(*hash, object->u); return;
 
+        case type_float:  *hash = hash_float(*hash, object->f); return;
+
         case type_str:
             *hash = hash_str(*hash, object->str, object->l);
             return;
-
-        // unused types in this benchmark
-        #if 0
-        case type_float:
-            write_float(hash, node_float(node));
-            return;
         case type_bin:
-            *hash = hash_str(*hash, node_data(node), node_data_len(node));
+            *hash = hash_bin(*hash, object->str, object->l);
             return;
         case type_ext:
-            *hash = hash_u8(*hash, node_exttype(node));
-            *hash = hash_str(*hash, node_data(node), node_data_len(node));
+            *hash = hash_ext(*hash, object_ext_type(object), object_ext_data(object), object->l);
             return;
-        #endif
 
         case type_array: {
             uint32_t count = object->l;
@@ -81,11 +75,12 @@ static void hash_object(object_t* object, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(insitu_data, insitu_size);
+    size_t size = insitu_size;
+    char* data = benchmark_in_situ_copy(insitu_data, &size);
     if (!data)
         return false;
 
-    hash_object(root_object, hash_out);
+    hash_object(benchmark_object(root_object), hash_out);
 
     benchmark_in_situ_free(data);
     return true;
@@ -97,9 +92,12 @@ bool setup_test(size_t object_size) {
     // As with hash-data, this is just a rough approximation of encoded
     // binary data. We need it here to create unused in-situ copies to
     // match all parsing tests.
-    insitu_size = 100;
-    for (size_t i = 0; i < object_size; ++i)
-        insitu_size <<= 3;
+    insitu_size = object_size;
+    if (object_size <= BENCHMARK_SIZE_MAX) {
+        insitu_size = 100;
+        for (size_t i = 0; i < object_size; ++i)
+            insitu_size <<= 3;
+    }
 
     srand(123);
     insitu_data = (char*)malloc(insitu_size);
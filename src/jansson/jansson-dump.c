@@ -78,7 +78,7 @@ static json_t* convert(object_t* object) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    json_t* root = convert(root_object);
+    json_t* root = convert(benchmark_object(root_object));
     if (!root)
         return false;
 
@@ -89,7 +89,9 @@ bool run_test(uint32_t* hash_out) {
 
     // we have to strlen() to get the result size i guess?
     char* result = json_dumps(root, flags);
-    *hash_out = hash_str(*hash_out, result, strlen(result));
+    size_t size = strlen(result);
+    benchmark_output_size(size);
+    *hash_out = hash_str(*hash_out, result, size);
     free(result);
 
     json_decref(root);
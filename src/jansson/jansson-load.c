@@ -117,7 +117,8 @@ static bool hash_json(json_t* json, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
@@ -130,15 +131,20 @@ bool run_test(uint32_t* hash_out) {
     // anyway.)
     int flags = 0;
 
+    benchmark_phase_begin(benchmark_phase_parse);
     json_error_t error;
-    json_t* root = json_loadb(data, file_size, flags, &error);
+    json_t* root = json_loadb(data, size, flags, &error);
     if (!root) {
+        benchmark_phase_end();
         benchmark_in_situ_free(data);
         return false;
     }
 
+    benchmark_phase_begin(benchmark_phase_traverse);
     bool ok = hash_json(root, hash_out);
+    benchmark_phase_begin(benchmark_phase_free);
     json_decref(root);
+    benchmark_phase_end();
     benchmark_in_situ_free(data);
     return ok;
 }
@@ -151,7 +157,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
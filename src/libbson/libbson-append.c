@@ -45,6 +45,10 @@ static bool append_value(bson_t* bson, const char* key, size_t length, object_t*
         case type_int:    append_int(bson, key, length, value->i);                   break; 
         case type_uint:   append_int(bson, key, length, (int64_t)value->u);          break;
 
+        case type_bin:
+            bson_append_binary(bson, key, length, BSON_SUBTYPE_BINARY, (const uint8_t*)value->str, value->l);
+            break;
+
         case type_map: {
             bson_t child;
             bson_append_document_begin(bson, key, length, &child);
@@ -87,13 +91,14 @@ static bool append_array(bson_t* bson, object_t* object) {
 }
 
 bool run_test(uint32_t* hash_out) {
+    object_t* object = benchmark_object(root_object);
     bson_t bson = BSON_INITIALIZER;
 
     bool ok;
-    if (root_object->type == type_map)
-        ok = append_document(&bson, root_object);
+    if (object->type == type_map)
+        ok = append_document(&bson, object);
     else
-        ok = append_array(&bson, root_object);
+        ok = append_array(&bson, object);
 
     if (!ok) {
         fprintf(stderr, "libbson error writing data!\n");
@@ -101,6 +106,7 @@ bool run_test(uint32_t* hash_out) {
         return false;
     }
 
+    benchmark_output_size(bson.len);
     *hash_out = hash_str(*hash_out, (const char*)bson_get_data(&bson), bson.len);
 
     // The documentation says that bson_destroy() should be called
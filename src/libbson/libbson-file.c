@@ -42,6 +42,10 @@ static bool append_value(bson_t* bson, const char* key, size_t length, object_t*
         case type_int:    append_int(bson, key, length, value->i);                   break; 
         case type_uint:   append_int(bson, key, length, (int64_t)value->u);          break;
 
+        case type_bin:
+            bson_append_binary(bson, key, length, BSON_SUBTYPE_BINARY, (const uint8_t*)value->str, value->l);
+            break;
+
         case type_map: {
             bson_t child;
             bson_append_document_begin(bson, key, length, &child);
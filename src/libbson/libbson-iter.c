@@ -49,6 +49,15 @@ bool hash_bson(bson_iter_t* iter, bool is_array, uint32_t* hash) {
                 break;
             }
 
+            case BSON_TYPE_BINARY: {
+                bson_subtype_t subtype;
+                uint32_t length;
+                const uint8_t* data;
+                bson_iter_binary(iter, &subtype, &length, &data);
+                *hash = hash_bin(*hash, (const char*)data, length);
+                break;
+            }
+
             case BSON_TYPE_DOCUMENT: {
                 bson_iter_t child;
                 bool ret = bson_iter_recurse(iter, &child);
@@ -79,12 +88,13 @@ bool hash_bson(bson_iter_t* iter, bool is_array, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
     bson_t bson;
-    bool ret = bson_init_static(&bson, (const uint8_t*)data, file_size);
+    bool ret = bson_init_static(&bson, (const uint8_t*)data, size);
     if (ret) {
         bson_iter_t iter;
 
@@ -128,7 +138,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -61,6 +61,10 @@ static void append_object(mongo::BSONObjBuilder& builder, object_t* object) {
             case type_int:    append_object_int(builder, keystr, (long long)value->i);         break;
             case type_uint:   append_object_int(builder, keystr, (long long)value->u);         break;
 
+            case type_bin:
+                builder.append(keystr, mongo::BSONBinData(value->str, value->l, mongo::BinDataGeneral));
+                break;
+
             case type_array: {
                 mongo::BSONArrayBuilder sub(builder.subarrayStart(keystr));
                 append_array(sub, value);
@@ -94,6 +98,10 @@ static void append_array(mongo::BSONArrayBuilder& builder, object_t* object) {
             case type_int:    append_array_int(builder, (long long)value->i);          break;
             case type_uint:   append_array_int(builder, (long long)value->u);          break;
 
+            case type_bin:
+                builder.append(mongo::BSONBinData(value->str, value->l, mongo::BinDataGeneral));
+                break;
+
             case type_array: {
                 mongo::BSONArrayBuilder sub(builder.subarrayStart());
                 append_array(sub, value);
@@ -115,18 +123,20 @@ static void append_array(mongo::BSONArrayBuilder& builder, object_t* object) {
 }
 
 bool run_test(uint32_t* hash_out) {
+    object_t* object = benchmark_object(root_object);
     try {
         mongo::BSONObj obj;
-        if (root_object->type == type_map) {
+        if (object->type == type_map) {
             mongo::BSONObjBuilder builder;
-            append_object(builder, root_object);
+            append_object(builder, object);
             obj = builder.obj();
         } else {
             mongo::BSONArrayBuilder builder;
-            append_array(builder, root_object);
+            append_array(builder, object);
             obj = builder.obj();
         }
 
+        benchmark_output_size(obj.objsize());
         *hash_out = hash_str(*hash_out, obj.objdata(), obj.objsize());
 
     } catch (std::exception e) {
@@ -53,6 +53,13 @@ bool hash_bson(mongo::BSONObj& obj, bool is_array, uint32_t* hash) {
                 break;
             }
 
+            case mongo::BinData: {
+                int length;
+                const char* data = e.binData(length);
+                *hash = hash_bin(*hash, data, length);
+                break;
+            }
+
             case mongo::Object: {
                 mongo::BSONObj obj = e.Obj();
                 hash_bson(obj, false, hash);
@@ -75,7 +82,8 @@ bool hash_bson(mongo::BSONObj& obj, bool is_array, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
@@ -84,7 +92,7 @@ bool run_test(uint32_t* hash_out) {
         // there doesn't seem to be a BSONObj constructor that takes a
         // length. how is it supposed to check whether the data was
         // truncated? will it just read uninitialized memory??
-        mongo::BSONObj obj(file_data);
+        mongo::BSONObj obj(data);
 
         // as with libbson-iter, we look at the first key to see if
         // it's a string zero to test whether we have an array or map.
@@ -107,7 +115,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -30,6 +30,12 @@ static void write_object(mpack_writer_t* writer, object_t* object) {
         case type_int:    mpack_write_i64   (writer, object->i);              break; 
         case type_uint:   mpack_write_u64   (writer, object->u);              break; 
         case type_str:    mpack_write_str   (writer, object->str, object->l); break; 
+        case type_float:  mpack_write_float (writer, object->f);              break;
+        case type_bin:    mpack_write_bin   (writer, object->str, object->l); break;
+
+        case type_ext:
+            mpack_write_ext(writer, object_ext_type(object), object_ext_data(object), object->l);
+            break;
 
         case type_array:
             mpack_start_array(writer, object->l);
@@ -30,6 +30,7 @@ static void hash_node(mpack_node_t node, uint32_t* hash) {
         case mpack_type_nil:    *hash = hash_nil(*hash); return;
         case mpack_type_bool:   *hash = hash_bool(*hash, mpack_node_bool(node)); return;
         case mpack_type_double: *hash = hash_double(*hash, mpack_node_double(node)); return;
+        case mpack_type_float:  *hash = hash_float(*hash, mpack_node_float(node)); return;
         case mpack_type_int:    *hash = hash_i64(*hash, mpack_node_i64(node)); return;
         case mpack_type_uint:   *hash = hash_u64(*hash, mpack_node_u64(node)); return;
 
@@ -40,6 +41,14 @@ static void hash_node(mpack_node_t node, uint32_t* hash) {
             *hash = hash_str(*hash, mpack_node_data(node), mpack_node_data_len(node));
             return;
 
+        case mpack_type_bin:
+            *hash = hash_bin(*hash, mpack_node_data(node), mpack_node_data_len(node));
+            return;
+
+        case mpack_type_ext:
+            *hash = hash_ext(*hash, mpack_node_exttype(node), mpack_node_data(node), mpack_node_data_len(node));
+            return;
+
         case mpack_type_array: {
             uint32_t count = mpack_node_array_length(node);
             for (uint32_t i = 0; i < count; ++i) {
@@ -78,15 +87,20 @@ static void hash_node(mpack_node_t node, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
+    benchmark_phase_begin(benchmark_phase_parse);
     mpack_tree_t tree;
-    mpack_tree_init(&tree, data, file_size);
+    mpack_tree_init(&tree, data, size);
+    benchmark_phase_begin(benchmark_phase_traverse);
     hash_node(mpack_tree_root(&tree), hash_out);
 
+    benchmark_phase_begin(benchmark_phase_free);
     mpack_error_t error = mpack_tree_destroy(&tree);
+    benchmark_phase_end();
     benchmark_in_situ_free(data);
     return error == mpack_ok;
 }
@@ -99,7 +113,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
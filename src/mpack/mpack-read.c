@@ -52,6 +52,24 @@ static void hash_element(mpack_reader_t* reader, uint32_t* hash) {
             return;
         }
 
+        case mpack_type_bin: {
+            const char* data = mpack_read_bytes_inplace(reader, tag.v.l);
+            if (mpack_reader_error(reader) != mpack_ok)
+                return;
+            *hash = hash_bin(*hash, data, tag.v.l);
+            mpack_done_bin(reader);
+            return;
+        }
+
+        case mpack_type_ext: {
+            const char* data = mpack_read_bytes_inplace(reader, tag.v.l);
+            if (mpack_reader_error(reader) != mpack_ok)
+                return;
+            *hash = hash_ext(*hash, tag.exttype, data, tag.v.l);
+            mpack_done_ext(reader);
+            return;
+        }
+
         case mpack_type_array:
             for (size_t i = 0; i < tag.v.n; ++i) {
                 hash_element(reader, hash);
@@ -91,12 +109,13 @@ static void hash_element(mpack_reader_t* reader, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
     mpack_reader_t reader;
-    mpack_reader_init_data(&reader, data, file_size);
+    mpack_reader_init_data(&reader, data, size);
 
     hash_element(&reader, hash_out);
 
@@ -113,7 +132,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -32,6 +32,12 @@ static void write_object(mpack_writer_t* writer, object_t* object) {
         case type_int:    mpack_write_i64   (writer, object->i);              break; 
         case type_uint:   mpack_write_u64   (writer, object->u);              break; 
         case type_str:    mpack_write_str   (writer, object->str, object->l); break; 
+        case type_float:  mpack_write_float (writer, object->f);              break;
+        case type_bin:    mpack_write_bin   (writer, object->str, object->l); break;
+
+        case type_ext:
+            mpack_write_ext(writer, object_ext_type(object), object_ext_data(object), object->l);
+            break;
 
         case type_array:
             mpack_start_array(writer, object->l);
@@ -68,12 +74,13 @@ bool run_test(uint32_t* hash_out) {
     mpack_writer_t writer;
     mpack_writer_init_growable(&writer, &data, &size);
 
-    write_object(&writer, root_object);
+    write_object(&writer, benchmark_object(root_object));
 
     mpack_error_t error = mpack_writer_destroy(&writer);
     if (error != mpack_ok)
         return false;
 
+    benchmark_output_size(size);
     *hash_out = hash_str(*hash_out, data, size);
     free(data);
     return true;
@@ -33,12 +33,23 @@ static bool pack_object(msgpack_packer* packer, object_t* object) {
         case type_int:    return msgpack_pack_long_long(packer, object->i) == 0;
         case type_uint:   return msgpack_pack_unsigned_long_long(packer, object->u) == 0;
         case type_double: return msgpack_pack_double(packer, object->d) == 0;
+        case type_float:  return msgpack_pack_float(packer, object->f) == 0;
 
         case type_str:
             if (msgpack_pack_str(packer, object->l) != 0)
                 return false;
             return msgpack_pack_str_body(packer, object->str, object->l) == 0;
 
+        case type_bin:
+            if (msgpack_pack_bin(packer, object->l) != 0)
+                return false;
+            return msgpack_pack_bin_body(packer, object->str, object->l) == 0;
+
+        case type_ext:
+            if (msgpack_pack_ext(packer, object->l, object_ext_type(object)) != 0)
+                return false;
+            return msgpack_pack_ext_body(packer, object_ext_data(object), object->l) == 0;
+
         case type_array:
             if (msgpack_pack_array(packer, object->l) != 0)
                 return false;
@@ -78,9 +89,10 @@ bool run_test(uint32_t* hash_out) {
     msgpack_packer packer;
     msgpack_packer_init(&packer, &buffer, msgpack_sbuffer_write);
 
-    if (!pack_object(&packer, root_object))
+    if (!pack_object(&packer, benchmark_object(root_object)))
         return false;
 
+    benchmark_output_size(buffer.size);
     *hash_out = hash_str(*hash_out, buffer.data, buffer.size);
     msgpack_sbuffer_destroy(&buffer);
     return true;
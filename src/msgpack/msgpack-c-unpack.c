@@ -33,6 +33,11 @@ static bool hash_object(msgpack_object* object, uint32_t* hash) {
         case MSGPACK_OBJECT_NEGATIVE_INTEGER: *hash = hash_i64(*hash, object->via.i64); return true;
         case MSGPACK_OBJECT_POSITIVE_INTEGER: *hash = hash_u64(*hash, object->via.u64); return true;
         case MSGPACK_OBJECT_STR:              *hash = hash_str(*hash, object->via.str.ptr, object->via.str.size); return true;
+        case MSGPACK_OBJECT_BIN:              *hash = hash_bin(*hash, object->via.bin.ptr, object->via.bin.size); return true;
+
+        case MSGPACK_OBJECT_EXT:
+            *hash = hash_ext(*hash, object->via.ext.type, object->via.ext.ptr, object->via.ext.size);
+            return true;
 
         case MSGPACK_OBJECT_ARRAY:
             for (size_t i = 0; i < object->via.array.size; ++i)
@@ -63,7 +68,8 @@ static bool hash_object(msgpack_object* object, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
@@ -76,17 +82,22 @@ bool run_test(uint32_t* hash_out) {
     // destroy the msgpack_unpacked, so it leaks its zone. We fix those
     // problems here.
 
+    benchmark_phase_begin(benchmark_phase_parse);
     msgpack_unpacked msg;
     msgpack_unpacked_init(&msg);
-    msgpack_unpack_return ret = msgpack_unpack_next(&msg, data, file_size, NULL);
+    msgpack_unpack_return ret = msgpack_unpack_next(&msg, data, size, NULL);
 
     if (ret != MSGPACK_UNPACK_SUCCESS) {
+        benchmark_phase_end();
         benchmark_in_situ_free(data);
         return false;
     }
 
+    benchmark_phase_begin(benchmark_phase_traverse);
     bool ok = hash_object(&msg.data, hash_out);
+    benchmark_phase_begin(benchmark_phase_free);
     msgpack_unpacked_destroy(&msg);
+    benchmark_phase_end();
     benchmark_in_situ_free(data);
     return ok;
 }
@@ -99,7 +110,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
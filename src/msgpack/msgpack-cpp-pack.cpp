@@ -34,12 +34,23 @@ static void pack_object(msgpack::packer<msgpack::sbuffer>& packer, object_t* obj
         case type_int:    packer.pack(object->i); return;
         case type_uint:   packer.pack(object->u); return;
         case type_double: packer.pack(object->d); return;
+        case type_float:  packer.pack(object->f); return;
 
         case type_str:
             packer.pack_str(object->l);
             packer.pack_str_body(object->str, object->l);
             return;
 
+        case type_bin:
+            packer.pack_bin(object->l);
+            packer.pack_bin_body(object->str, object->l);
+            return;
+
+        case type_ext:
+            packer.pack_ext(object->l, object_ext_type(object));
+            packer.pack_ext_body(object_ext_data(object), object->l);
+            return;
+
         case type_array:
             packer.pack_array(object->l);
             for (size_t i = 0; i < object->l; ++i)
@@ -71,7 +82,8 @@ bool run_test(uint32_t* hash_out) {
     try {
         msgpack::sbuffer buffer;
         msgpack::packer<msgpack::sbuffer> packer(buffer);
-        pack_object(packer, root_object);
+        pack_object(packer, benchmark_object(root_object));
+        benchmark_output_size(buffer.size());
         *hash_out = hash_str(*hash_out, buffer.data(), buffer.size());
 
     } catch (std::exception e) {
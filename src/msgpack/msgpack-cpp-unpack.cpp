@@ -33,6 +33,11 @@ static void hash_object(const msgpack::object& object, uint32_t* hash) {
         case msgpack::type::NEGATIVE_INTEGER: *hash = hash_i64(*hash, object.via.i64); return;
         case msgpack::type::POSITIVE_INTEGER: *hash = hash_u64(*hash, object.via.u64); return;
         case msgpack::type::STR:              *hash = hash_str(*hash, object.via.str.ptr, object.via.str.size); return;
+        case msgpack::type::BIN:              *hash = hash_bin(*hash, object.via.bin.ptr, object.via.bin.size); return;
+
+        case msgpack::type::EXT:
+            *hash = hash_ext(*hash, object.via.ext.type(), object.via.ext.data(), object.via.ext.size);
+            return;
 
         case msgpack::type::ARRAY:
             for (size_t i = 0; i < object.via.array.size; ++i)
@@ -61,19 +66,27 @@ static void hash_object(const msgpack::object& object, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
-    msgpack::unpacked msg;
-    try {
-        msgpack::unpack(&msg, data, file_size);
-        hash_object(msg.get(), hash_out);
-    } catch (msgpack::unpack_error error) {
-        benchmark_in_situ_free(data);
-        return false;
+    // the message is scoped so that its destruction is timed as the free phase
+    {
+        benchmark_phase_begin(benchmark_phase_parse);
+        msgpack::unpacked msg;
+        try {
+            msgpack::unpack(&msg, data, size);
+            benchmark_phase_begin(benchmark_phase_traverse);
+            hash_object(msg.get(), hash_out);
+        } catch (msgpack::unpack_error error) {
+            benchmark_phase_end();
+            benchmark_in_situ_free(data);
+            return false;
+        }
+        benchmark_phase_begin(benchmark_phase_free);
     }
-
+    benchmark_phase_end();
     benchmark_in_situ_free(data);
     return true;
 }
@@ -86,7 +99,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
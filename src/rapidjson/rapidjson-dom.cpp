@@ -81,19 +81,28 @@ static bool hash_value(Value& value, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
-    Document document;
-    #if BENCHMARK_IN_SITU
-    document.ParseInsitu(data);
-    #else
-    MemoryStream s(data, file_size);
-    document.ParseStream(s);
-    #endif
-
-    bool ok = hash_value(document, hash_out);
+    // the document is scoped so that its destruction is timed as the free phase
+    bool ok;
+    {
+        benchmark_phase_begin(benchmark_phase_parse);
+        Document document;
+        #if BENCHMARK_IN_SITU
+        document.ParseInsitu(data);
+        #else
+        MemoryStream s(data, size);
+        document.ParseStream(s);
+        #endif
+
+        benchmark_phase_begin(benchmark_phase_traverse);
+        ok = hash_value(document, hash_out);
+        benchmark_phase_begin(benchmark_phase_free);
+    }
+    benchmark_phase_end();
     benchmark_in_situ_free(data);
     return ok;
 }
@@ -106,7 +115,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -72,7 +72,8 @@ struct Hasher {
 };
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
@@ -84,7 +85,7 @@ bool run_test(uint32_t* hash_out) {
         InsituStringStream s(data);
         reader.Parse<kParseDefaultFlags|kParseInsituFlag>(s, hasher);
         #else
-        MemoryStream s(data, file_size);
+        MemoryStream s(data, size);
         reader.Parse(s, hasher);
         #endif
         *hash_out = hasher.hash;
@@ -105,7 +106,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -64,7 +64,8 @@ static void write_object(Writer<StringBuffer>& writer, object_t* object) {
 bool run_test(uint32_t* hash_out) {
     StringBuffer buffer;
     Writer<StringBuffer> writer(buffer);
-    write_object(writer, root_object);
+    write_object(writer, benchmark_object(root_object));
+    benchmark_output_size(buffer.GetSize());
     *hash_out = hash_str(*hash_out, buffer.GetString(), buffer.GetSize());
     return true;
 }
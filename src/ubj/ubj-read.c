@@ -119,11 +119,12 @@ static void hash_value(void* data, UBJ_TYPE type, size_t index, uint32_t* hash)
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
-    ubjr_context_t* src = ubjr_open_memory((uint8_t*)data, (uint8_t*)(data + file_size));
+    ubjr_context_t* src = ubjr_open_memory((uint8_t*)data, (uint8_t*)(data + size));
     ubjr_dynamic_t dynamic = ubjr_read_dynamic(src);
     hash_value(&dynamic, UBJ_MIXED, 0, hash_out);
     ubjr_cleanup_dynamic(&dynamic);
@@ -165,7 +166,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
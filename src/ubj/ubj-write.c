@@ -168,14 +168,16 @@ static bool write_object(ubjw_context_t* dst, object_t* object) {
 
 bool run_test(uint32_t* hash_out) {
     buffer_t buffer;
-    buffer_init(&buffer);
+    if (!buffer_init(&buffer))
+        return false;
     ubjw_context_t* dst = ubjw_open_callback(&buffer, buffer_ubj_write, NULL, error_fn);
 
-    if (!write_object(dst, root_object) || error_occurred) {
+    if (!write_object(dst, benchmark_object(root_object)) || error_occurred) {
         buffer_destroy(&buffer);
         return false;
     }
 
+    benchmark_output_size(buffer.count);
     *hash_out = hash_str(*hash_out, buffer.data, buffer.count);
     buffer_destroy(&buffer);
     ubjw_close_context(dst);
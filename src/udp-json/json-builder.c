@@ -86,7 +86,7 @@ static json_value* create_value(object_t* object) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    json_value* value = create_value(root_object);
+    json_value* value = create_value(benchmark_object(root_object));
     if (!value)
         return false;
 
@@ -99,6 +99,7 @@ bool run_test(uint32_t* hash_out) {
     }
     json_serialize_ex(buf, value, opts);
 
+    benchmark_output_size(len);
     *hash_out = hash_str(*hash_out, (const char*)buf, len);
     free(buf);
     json_builder_free(value);
@@ -67,18 +67,24 @@ static bool hash_json(json_value* value, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
-    json_value* root = json_parse(data, file_size);
+    benchmark_phase_begin(benchmark_phase_parse);
+    json_value* root = json_parse(data, size);
     if (!root) {
+        benchmark_phase_end();
         benchmark_in_situ_free(data);
         return false;
     }
 
+    benchmark_phase_begin(benchmark_phase_traverse);
     bool ok = hash_json(root, hash_out);
+    benchmark_phase_begin(benchmark_phase_free);
     json_value_free(root);
+    benchmark_phase_end();
     benchmark_in_situ_free(data);
     return ok;
 }
@@ -91,7 +97,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -73,12 +73,13 @@ static bool gen_object(yajl_gen gen, object_t* object) {
 bool run_test(uint32_t* hash_out) {
     yajl_gen gen = yajl_gen_alloc(NULL);
 
-    if (!gen_object(gen, root_object))
+    if (!gen_object(gen, benchmark_object(root_object)))
         return false;
 
     const unsigned char* buf;
     size_t len;
     yajl_gen_get_buf(gen, &buf, &len);
+    benchmark_output_size(len);
     *hash_out = hash_str(*hash_out, (const char*)buf, len);
 
     yajl_gen_free(gen);
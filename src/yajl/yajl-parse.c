@@ -110,7 +110,8 @@ static yajl_callbacks callbacks = {
 };
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
@@ -118,7 +119,7 @@ bool run_test(uint32_t* hash_out) {
     parser_init(&parser, *hash_out);
 
     yajl_handle handle = yajl_alloc(&callbacks, NULL, &parser);
-    yajl_status status = yajl_parse(handle, (const unsigned char*)file_data, file_size);
+    yajl_status status = yajl_parse(handle, (const unsigned char*)data, size);
     if (status == yajl_status_ok)
         status = yajl_complete_parse(handle);
     yajl_free(handle);
@@ -136,7 +137,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
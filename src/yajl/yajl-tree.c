@@ -85,19 +85,25 @@ static bool hash_node(yajl_val node, uint32_t* hash) {
 }
 
 bool run_test(uint32_t* hash_out) {
-    char* data = benchmark_in_situ_copy(file_data, file_size);
+    size_t size = file_size;
+    char* data = benchmark_in_situ_copy(file_data, &size);
     if (!data)
         return false;
 
+    benchmark_phase_begin(benchmark_phase_parse);
     char errbuf[1024];
     yajl_val node = yajl_tree_parse(data, errbuf, sizeof(errbuf));
     if (node == NULL) {
+        benchmark_phase_end();
         benchmark_in_situ_free(data);
         return false;
     }
 
+    benchmark_phase_begin(benchmark_phase_traverse);
     bool ok = hash_node(node, hash_out);
+    benchmark_phase_begin(benchmark_phase_free);
     yajl_tree_free(node);
+    benchmark_phase_end();
     benchmark_in_situ_free(data);
     return ok;
 }
@@ -110,7 +116,7 @@ bool setup_test(size_t object_size) {
 }
 
 void teardown_test(void) {
-    free(file_data);
+    free_data_file(file_data);
 }
 
 bool is_benchmark(void) {
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2016 Nicholas Fraser
+# 
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+# 
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+# 
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+import os, struct, subprocess, sys
+
+# Symbolizes the stacks sampled by the harness with -S into folded stacks
+# for flame graphs (e.g. flamegraph.pl from Brendan Gregg's FlameGraph.)
+#
+# usage: tools/fold.py build/profiles/*.raw
+#
+# Each .raw file is written next to it as a .folded file. The raw frames
+# are module paths and offsets since the tests are stripped; we look them
+# up with addr2line in the unstripped build/<test>.debug executable if
+# there is one, or otherwise in the module itself. Inlined functions are
+# expanded into frames of their own. Frames that can't be symbolized are
+# left as the module name and offset.
+
+# returns the lowest address loaded from an ELF file. offsets from the
+# module base are relative to this, which is 0 for shared objects and
+# position-independent executables.
+def loadbase(path):
+    try:
+        with open(path, 'rb') as f:
+            header = f.read(64)
+            if header[:4] != b'\x7fELF':
+                return 0
+            is64 = header[4] == 2
+            endian = header[5] == 1 and '<' or '>'
+            if is64:
+                phoff, = struct.unpack(endian + 'Q', header[32:40])
+                phentsize, phnum = struct.unpack(endian + 'HH', header[54:58])
+            else:
+                phoff, = struct.unpack(endian + 'I', header[28:32])
+                phentsize, phnum = struct.unpack(endian + 'HH', header[42:46])
+            base = None
+            for i in range(phnum):
+                f.seek(phoff + i * phentsize)
+                entry = f.read(phentsize)
+                if is64:
+                    kind, = struct.unpack(endian + 'I', entry[0:4])
+                    vaddr, = struct.unpack(endian + 'Q', entry[16:24])
+                else:
+                    kind, vaddr = struct.unpack(endian + 'II', entry[0:4] + entry[8:12])
+                if kind == 1 and (base is None or vaddr < base): # PT_LOAD
+                    base = vaddr
+            return base or 0
+    except (IOError, struct.error):
+        return 0
+
+# returns a dict of offset -> list of function names from the outermost
+# inlined function to the innermost, or None if unknown
+def symbolize(module, offsets):
+    path = module
+    if os.path.exists(module + '.debug'):
+        path = module + '.debug'
+    if not os.path.exists(path):
+        return {}
+    base = loadbase(path)
+    offsets = sorted(offsets)
+    addresses = ['0x%x' % (base + offset) for offset in offsets]
+    try:
+        output = subprocess.run(['addr2line', '-a', '-f', '-C', '-i', '-e', path],
+                input='\n'.join(addresses) + '\n', stdout=subprocess.PIPE,
+                universal_newlines=True, check=True).stdout
+    except (OSError, subprocess.CalledProcessError):
+        return {}
+
+    # each address is printed followed by a function and location line
+    # for it and for each function it's inlined into
+    names = {}
+    lines = output.split('\n')
+    index = -1
+    i = 0
+    while i < len(lines):
+        line = lines[i]
+        if line.startswith('0x') and index + 1 < len(offsets) and int(line, 16) == base + offsets[index + 1]:
+            index += 1
+            names[offsets[index]] = []
+            i += 1
+            continue
+        if index >= 0 and line != '':
+            if line != '??':
+                names[offsets[index]].insert(0, line)
+            i += 2
+            continue
+        i += 1
+    return names
+
+def parseframe(frame):
+    module, plus, offset = frame.rpartition('+0x')
+    if not plus:
+        return None, frame
+    return module, int(offset, 16)
+
+def fold(rawname):
+    stacks = []
+    with open(rawname) as raw:
+        for line in raw:
+            line = line.rstrip('\n')
+            if line == '':
+                continue
+            frames, count = line.rsplit(' ', 1)
+            stacks.append(([parseframe(frame) for frame in frames.split(';')], int(count)))
+
+    # the frames other than the leaf are return addresses, which point
+    # after the call, so we look up the call instruction itself
+    wanted = {}
+    for frames, count in stacks:
+        for i, (module, offset) in enumerate(frames):
+            if module is not None:
+                wanted.setdefault(module, set()).add(i == len(frames) - 1 and offset or offset - 1)
+    names = {}
+    for module, offsets in wanted.items():
+        names[module] = symbolize(module, offsets)
+
+    folded = {}
+    for frames, count in stacks:
+        out = []
+        for i, (module, offset) in enumerate(frames):
+            if module is None:
+                out.append(offset)
+                continue
+            lookup = i == len(frames) - 1 and offset or offset - 1
+            functions = names[module].get(lookup)
+            if functions:
+                out += functions
+            else:
+                out.append('%s+0x%x' % (os.path.basename(module), offset))
+        stack = ';'.join(out)
+        folded[stack] = folded.get(stack, 0) + count
+
+    foldedname = os.path.splitext(rawname)[0] + '.folded'
+    with open(foldedname, 'w') as out:
+        for stack, count in sorted(folded.items()):
+            out.write('%s %i\n' % (stack, count))
+    return foldedname
+
+if len(sys.argv) < 2:
+    sys.stderr.write('usage: tools/fold.py build/profiles/*.raw\n')
+    sys.exit(1)
+for rawname in sys.argv[1:]:
+    print(fold(rawname))
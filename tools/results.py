@@ -21,7 +21,7 @@
 
 import csv, sys
 from functools import reduce
-from math import sqrt
+from math import sqrt, log
 
 benchmarks_url = 'https://github.com/ludocode/schemaless-benchmarks/blob/master/'
 
@@ -91,21 +91,239 @@ _The Time and Code Size columns show the net result after subtracting the hash-d
 _The Time and Code Size columns show the net result after subtracting the hash-object time and size. In both columns, lower is better._
 """
 
+throughput_footnote = """
+_The Speed and Nodes columns show the throughput of the library alone, computed from the net time: megabytes of encoded data (the input data file, or the output of Write tests) and millions of nodes of the object (every value, including map keys) per second. Unlike the time, these can be compared across object sizes and across formats with different encoded lengths. Higher is better._
+"""
+
+latency_footnote = """
+_The latency columns show percentiles of the time taken by individual iterations, without hash subtraction. They are only recorded for tests run with the -l option, or with the -x option which times iterations with the TSC and subtracts the timer overhead._
+"""
+
 csvname = 'results.csv'
 
-NAME, LANGUAGE, VERSION, FILE, FORMAT, OBJECT_SIZE, TIME, BINARY_SIZE, SIZE_OPTIMIZED, HASH = range(10)
+NAME, LANGUAGE, VERSION, FILE, FORMAT, OBJECT_SIZE, TIME, BINARY_SIZE, SIZE_OPTIMIZED, HASH, THREADS, \
+        P50, P90, P99, P999, LATENCY_MAX, DATA_SIZE, \
+        CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, DTLB_MISSES, \
+        ALLOCATIONS, ALLOCATED_BYTES, PEAK_BYTES, \
+        SETUP_MINOR_FAULTS, SETUP_MAJOR_FAULTS, SETUP_RSS, \
+        WARM_MINOR_FAULTS, WARM_MAJOR_FAULTS, WARM_RSS, \
+        WORK_MINOR_FAULTS, WORK_MAJOR_FAULTS, WORK_RSS, CACHE, CORPUS, CI, \
+        CPU, GOVERNOR, SMT, SPIN, DRIFT, TIMER, NODES, INPUT, ZERO_COPY, HUGE_PAGES, HUGE_KB, ALLOCATOR, HEAP, \
+        PARSE_TIME, TRAVERSE_TIME, FREE_TIME, WORKLOAD, EXACT = range(56)
+COLUMNS = 56
+
+# latency columns are empty unless the test was run with -l
+LATENCIES = [P50, P90, P99, P999, LATENCY_MAX]
+
+# hardware counters per iteration are empty unless the test was run with -c
+COUNTERS = [CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, DTLB_MISSES]
+
+# allocations per iteration and peak heap usage, counted outside the timed loop
+ALLOCS = [ALLOCATIONS, ALLOCATED_BYTES, PEAK_BYTES]
+
+# microseconds per iteration in each phase of a tree test, empty unless the test was run with -b
+PHASES = [PARSE_TIME, TRAVERSE_TIME, FREE_TIME]
+
+# page faults and peak RSS above the baseline in KB for each phase (work faults are per iteration)
+USAGE = [SETUP_MINOR_FAULTS, SETUP_MAJOR_FAULTS, SETUP_RSS,
+        WARM_MINOR_FAULTS, WARM_MAJOR_FAULTS, WARM_RSS,
+        WORK_MINOR_FAULTS, WORK_MAJOR_FAULTS, WORK_RSS]
+
+# defaults for columns missing from rows written by older harness versions
+defaults = {THREADS: "1", P50: "", P90: "", P99: "", P999: "", LATENCY_MAX: "", DATA_SIZE: "0",
+        CYCLES: "", INSTRUCTIONS: "", BRANCH_MISSES: "", L1D_MISSES: "", LLC_MISSES: "", DTLB_MISSES: "",
+        ALLOCATIONS: "", ALLOCATED_BYTES: "", PEAK_BYTES: ""}
+for column in USAGE:
+    defaults[column] = ""
+defaults[CACHE] = "warm"
+defaults[CORPUS] = "1"
+defaults[CI] = ""
+defaults[CPU] = ""
+defaults[GOVERNOR] = ""
+defaults[SMT] = ""
+defaults[SPIN] = ""
+defaults[DRIFT] = ""
+defaults[TIMER] = "clock"
+defaults[NODES] = ""
+defaults[INPUT] = "read"
+defaults[ZERO_COPY] = ""
+defaults[HUGE_PAGES] = ""
+defaults[HUGE_KB] = ""
+defaults[ALLOCATOR] = "glibc"
+defaults[HEAP] = "default"
+for column in PHASES:
+    defaults[column] = ""
+defaults[WORKLOAD] = "default"
+defaults[EXACT] = "0"
+
+# the allocators results are compared against: malloc() as it comes with
+# the C library (glibc's, or libsystem_malloc on macOS)
+SYSTEM_ALLOCATORS = ["glibc", "system_malloc"]
+
+# the clock speed change over a test beyond which its result is flagged
+# (see DRIFT_TOLERANCE in benchmark.c)
+DRIFT_TOLERANCE = 0.03
+
+# the environments the results were run in, as (cpu, governor, smt)
+environments = set()
 
 # data[size][name]
 data = {}
 for i in range(1,6):
     data[i] = {}
 
+# scaling[size][name][threads] is a list of times from multi-threaded runs
+scaling = {}
+for i in range(1,6):
+    scaling[i] = {}
+
+# cold[size][name][cache] is a list of times from cold cache runs
+cold = {}
+for i in range(1,6):
+    cold[i] = {}
+
+# corpus[size][name][documents] is a list of times from corpus runs
+corpus = {}
+for i in range(1,6):
+    corpus[i] = {}
+
+# mapped[size][name][mode] is a list of times from mapped input runs, and
+# zerocopy[name][mode] is whether the test parsed the mapping directly
+mapped = {}
+for i in range(1,6):
+    mapped[i] = {}
+zerocopy = {}
+
+# huge[size][name][mode] is a list of [time, dTLB misses, huge KB] from
+# huge page runs (the misses and KB are None if not known)
+huge = {}
+for i in range(1,6):
+    huge[i] = {}
+
+# allocators[size][name][allocator] is a list of times from runs with
+# another allocator preloaded
+allocators = {}
+for i in range(1,6):
+    allocators[i] = {}
+
+# heaps[size][name][profile] is a list of times from runs with another
+# heap fragmentation profile
+heaps = {}
+for i in range(1,6):
+    heaps[i] = {}
+
+# phases[size][name] is a list of [time, parse, traverse, free] from runs
+# timing the phases of tree tests
+phases = {}
+for i in range(1,6):
+    phases[i] = {}
+
+# workloads[size][name][profile] is a list of [time, data size] from runs
+# with data generated by another workload profile
+workloads = {}
+for i in range(1,6):
+    workloads[i] = {}
+
+# exact[size][profile][name] is the hash from runs hashing doubles by value,
+# with data generated by the default or another workload profile
+exact = {}
+for i in range(1,6):
+    exact[i] = {}
+
+# the write tests, whose hashes are of their output rather than the values
+write_tests = set()
+
+# sweep[name][bytes] is a list of [time, data size] from runs with a target
+# size in bytes rather than a size class (see object_create_sized())
+SIZE_MAX = 5
+SUPERLINEAR = 1.1
+sweep = {}
+
+# returns true if the row was run in the default configuration, i.e. it
+# belongs in the main tables rather than in one of the extra sections
+def baseline(row):
+    return len(variations(row)) == 0
+
+# returns the columns of the options the row was run with that differ from
+# the default configuration
+def variations(row):
+    varied = []
+    if int(row[THREADS]) != 1:
+        varied.append(THREADS)
+    if row[CACHE] != "warm":
+        varied.append(CACHE)
+    if int(row[CORPUS]) != 1:
+        varied.append(CORPUS)
+    if row[INPUT] != "read":
+        varied.append(INPUT)
+    if row[HUGE_PAGES] != "":
+        varied.append(HUGE_PAGES)
+    if row[ALLOCATOR] not in SYSTEM_ALLOCATORS:
+        varied.append(ALLOCATOR)
+    if row[HEAP] != "default":
+        varied.append(HEAP)
+    if row[PARSE_TIME] != "":
+        varied.append(PARSE_TIME)
+    if row[WORKLOAD] != "default":
+        varied.append(WORKLOAD)
+    if row[EXACT] == "1":
+        varied.append(EXACT)
+    return varied
+
 # collect data in csv
 with open(csvname) as csvfile:
     reader = csv.reader(csvfile)
     for row in reader:
         if not size_results == int(row[SIZE_OPTIMIZED]):
             continue
+        for column in range(len(row), COLUMNS):
+            row.append(defaults[column])
+        if row[GOVERNOR] != "" or row[SMT] != "":
+            environments.add((row[CPU], row[GOVERNOR], row[SMT]))
+
+        if int(row[OBJECT_SIZE]) > SIZE_MAX:
+            if baseline(row):
+                runs = sweep.setdefault(row[NAME], {}).setdefault(int(row[OBJECT_SIZE]), [])
+                runs.append([float(row[TIME]), int(row[DATA_SIZE])])
+            continue
+
+        # each extra section varies one option from the baseline
+        varied = variations(row)
+        size = int(row[OBJECT_SIZE])
+        if varied == [CACHE]:
+            times = cold[size].setdefault(row[NAME], {})
+            times.setdefault(row[CACHE], []).append(float(row[TIME]))
+        elif varied == [CORPUS]:
+            times = corpus[size].setdefault(row[NAME], {})
+            times.setdefault(int(row[CORPUS]), []).append(float(row[TIME]))
+        elif varied == [THREADS]:
+            times = scaling[size].setdefault(row[NAME], {})
+            times.setdefault(int(row[THREADS]), []).append(float(row[TIME]))
+        elif varied == [INPUT]:
+            times = mapped[size].setdefault(row[NAME], {})
+            times.setdefault(row[INPUT], []).append(float(row[TIME]))
+            zerocopy.setdefault(row[NAME], {})[row[INPUT]] = row[ZERO_COPY] == "1"
+        elif varied == [HUGE_PAGES]:
+            runs = huge[size].setdefault(row[NAME], {}).setdefault(row[HUGE_PAGES], [])
+            runs.append([float(row[TIME]),
+                    row[DTLB_MISSES] != "" and float(row[DTLB_MISSES]) or None,
+                    row[HUGE_KB] != "" and int(row[HUGE_KB]) or None])
+        elif varied == [ALLOCATOR]:
+            times = allocators[size].setdefault(row[NAME], {})
+            times.setdefault(row[ALLOCATOR], []).append(float(row[TIME]))
+        elif varied == [HEAP]:
+            times = heaps[size].setdefault(row[NAME], {})
+            times.setdefault(row[HEAP], []).append(float(row[TIME]))
+        elif varied == [WORKLOAD]:
+            runs = workloads[size].setdefault(row[NAME], {}).setdefault(row[WORKLOAD], [])
+            runs.append([float(row[TIME]), int(row[DATA_SIZE])])
+        elif EXACT in varied and set(varied) <= set([EXACT, WORKLOAD]):
+            exact[size].setdefault(row[WORKLOAD], {})[row[NAME]] = row[HASH]
+        elif varied == [PARSE_TIME]:
+            runs = phases[size].setdefault(row[NAME], [])
+            runs.append([float(row[TIME])] + [float(row[column]) for column in PHASES])
+        if len(varied) > 0:
+            continue
 
         sizedata = data[int(row[OBJECT_SIZE])]
         name = row[NAME]
@@ -116,10 +334,22 @@ with open(csvname) as csvfile:
                 raise Exception("row code size does not match! did you 'make clean'?\nnew row: " +
                         str(row) + "\nexisting row: " + str(sizedata[name]))
             sizedata[name][TIME].append(float(row[TIME]))
+            for column in LATENCIES + COUNTERS + ALLOCS + USAGE + [CI, SPIN, DRIFT]:
+                if row[column] != "":
+                    sizedata[name][column].append(float(row[column]))
         else:
             row[TIME] = [float(row[TIME])]
+            for column in LATENCIES + COUNTERS + ALLOCS + USAGE + [CI, SPIN, DRIFT]:
+                row[column] = row[column] != "" and [float(row[column])] or []
             sizedata[name] = row
 
+# latency columns are shown only if some test was run with -l
+show_latency = False
+for sizedata in data.values():
+    for row in sizedata.values():
+        if len(row[P50]) > 0:
+            show_latency = True
+
 def printheader(test):
     print()
     print(test)
@@ -130,13 +360,16 @@ def printheader(test):
         header += ' Benchmark |'
         divider += '----|'
 
-    header += ' Format | Time<br>(μs)%s | Code Size<br>(bytes)%s |'
+    header += ' Format | Time<br>(μs)%s | Code Size<br>(bytes)%s | Speed<br>(MB/s) | Nodes<br>(M/s) |'
     header = header % (size_results and ("", " ▲") or (" ▲", ""))
-    divider += '----|---:|---:|'
+    divider += '----|---:|---:|---:|---:|'
 
     if show_overhead:
         header += ' Time<br>Overhead |'
         divider += '---:|'
+    if show_latency:
+        header += ' p50<br>(μs) | p99<br>(μs) | p99.9<br>(μs) | Max<br>(μs) |'
+        divider += '---:|---:|---:|---:|'
     if show_hash:
         header += ' Hash |'
         divider += '---:|'
@@ -160,6 +393,10 @@ def rowtime(row):
     if count > 1:
         sumsqr = reduce(lambda x, y: x + pow(y - mean, 2), times, 0)
         stdev = sqrt(sumsqr / (count - 1))
+    elif len(row[CI]) > 0:
+        # with a single run, use the standard error measured by the
+        # harness (the confidence interval is about two of them)
+        stdev = row[CI][0] / 1.96
     else:
         stdev = mean
 
@@ -187,7 +424,27 @@ def rowoverhead(row, sub):
     stdev = overhead * sqrt(pow(timedev / time, 2) + pow(subdev / subtime, 2))
     return rowstring(overhead, stdev)
 
+# the throughput of the library itself, from the net time after hash
+# subtraction, in MB/s of encoded data and millions of nodes per second
+def throughputstr(row, sub):
+    net = rowtime(row)[0] - rowtime(sub)[0]
+    if net <= 0:
+        return '-', '-'
+    speed = int(row[DATA_SIZE]) > 0 and '%.0f' % (int(row[DATA_SIZE]) / net) or '-'
+    nodes = row[NODES] != "" and '%.1f' % (float(row[NODES]) / net) or '-'
+    return speed, nodes
+
+def latencystr(row, column):
+    values = row[column]
+    if len(values) == 0:
+        return '-'
+    if column == LATENCY_MAX:
+        return '%.2f' % max(values)
+    return '%.2f' % (sum(values) / len(values))
+
 def addrow(rows, sizedata, name, write):
+    if write:
+        write_tests.add(name)
     if name not in sizedata:
         return
     row = sizedata[name]
@@ -222,14 +479,436 @@ def addrow(rows, sizedata, name, write):
     else:
         p = '| [%s][%s] (%s)%s [(%s)][%s] |' % (fullname, urlref, version, config, language, name)
 
-    p += ' %s | %s | %i |' % \
-            (row[FORMAT], timestr, size)
+    p += ' %s | %s | %i | %s | %s |' % \
+            ((row[FORMAT], timestr, size) + throughputstr(row, sub))
     if show_overhead:
         p += ' %s |' % overheadstr
+    if show_latency:
+        for column in [P50, P99, P999, LATENCY_MAX]:
+            p += ' %s |' % latencystr(row, column)
     if show_hash:
         p += ' %s |' % row[HASH]
     rows.append([size_results and size or time, p])
 
+def printscaling(sizedata, sizescaling):
+    if len(sizescaling) == 0:
+        return
+    print("### Thread Scaling")
+    print()
+    print('| Benchmark | Threads | Time<br>(μs) | Throughput<br>(iterations/s) | Scaling<br>Efficiency |')
+    print('|----|---:|---:|---:|---:|')
+    for name in sorted(sizescaling.keys()):
+        if name not in sizedata:
+            continue
+        single = rowtime(sizedata[name])[0]
+        for threads, times in sorted(sizescaling[name].items()):
+            time = sum(times) / len(times)
+            rate = threads * 1000000.0 / time
+            efficiency = single / time * 100.0
+            print('| [%s][%s] | %i | %.2f | %.0f | %.1f%% |' %
+                    (sizedata[name][FILE].split('/')[-1], name, threads, time, rate, efficiency))
+    print()
+    print("""
+_The Time column shows the time per iteration on each thread, without hash subtraction. The Throughput column shows the total iterations per second across all threads. Scaling Efficiency is the throughput relative to perfect linear scaling of the single-threaded result; lower efficiency indicates contention on shared state or the allocator._
+""")
+    print()
+
+def average(values):
+    return sum(values) / len(values)
+
+def printcorpus(sizedata, sizecorpus):
+    names = [name for name in sorted(sizecorpus.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    print("### Corpus")
+    print()
+    print('| Benchmark | Documents | Single Document<br>(μs) | Corpus<br>(μs per document) | Slowdown |')
+    print('|----|---:|---:|---:|---:|')
+    for name in names:
+        single = rowtime(sizedata[name])[0]
+        for documents, times in sorted(sizecorpus[name].items()):
+            time = average(times)
+            print('| [%s][%s] | %i | %.3f | %.3f | %.2fx |' % (sizedata[name][FILE].split('/')[-1],
+                    name, documents, single, time, time / single))
+    print()
+    print("""
+_Corpus results cycle through documents generated with different seeds but the same profile, so the branch predictor can't learn the token sequence of a single document. The documents vary in size, so compare the slowdown between libraries rather than the absolute times. Times do not have hash subtraction._
+""")
+    print()
+
+def printcold(sizedata, sizecold):
+    names = [name for name in sorted(sizecold.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    print("### Cold Cache")
+    print()
+    print('| Benchmark | Warm<br>(μs) | Cold<br>(μs) | Cold<br>Slowdown | Evicted<br>(μs) | Evicted<br>Slowdown |')
+    print('|----|---:|---:|---:|---:|---:|')
+    for name in names:
+        warm = rowtime(sizedata[name])[0]
+        p = '| [%s][%s] | %.3f |' % (sizedata[name][FILE].split('/')[-1], name, warm)
+        for cache in ["cold", "evict"]:
+            if cache in sizecold[name]:
+                time = average(sizecold[name][cache])
+                p += ' %.3f | %.2fx |' % (time, time / warm)
+            else:
+                p += ' - | - |'
+        print(p)
+    print()
+    print("""
+_Cold results rotate through copies of the input data spread over twice the size of the last level cache, so the input isn't in cache when it's parsed. Parsers that don't modify their input parse the cold copy directly, so unlike warm results their times don't include an in-situ copy. Evicted results also evict the caches between iterations, so the library's own code and data are cold as well. Times do not have hash subtraction._
+""")
+    print()
+
+def printmapped(sizedata, sizemapped):
+    names = [name for name in sorted(sizemapped.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    print("### Mapped Input")
+    print()
+    print('| Benchmark | Read<br>(μs) | Mapping | Mapped<br>(μs) | Speedup | Zero-Copy |')
+    print('|----|---:|----|---:|---:|:---:|')
+    for name in names:
+        read = rowtime(sizedata[name])[0]
+        for mode, times in sorted(sizemapped[name].items()):
+            time = average(times)
+            print('| [%s][%s] | %.3f | %s | %.3f | %.2fx | %s |' % (sizedata[name][FILE].split('/')[-1],
+                    name, read, mode, time, read / time, zerocopy[name][mode] and "yes" or "no"))
+    print()
+    print("""
+_Mapped results parse data files mapped read-only with mmap() rather than read into the heap. Parsers that don't modify their input parse the mapping directly (zero-copy); in-situ parsers still parse a copy. The mapping flags are populate (MAP_POPULATE), hugepage (MADV_HUGEPAGE) and sequential (MADV_SEQUENTIAL). A library that writes to its input fails the run, so it has no mapped results. Times do not have hash subtraction._
+""")
+    print()
+
+def printhuge(sizedata, sizehuge):
+    names = [name for name in sorted(sizehuge.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    print("### Huge Pages")
+    print()
+    print('| Benchmark | 4 KB Pages<br>(μs) | Huge Pages | Time<br>(μs) | Speedup | dTLB Misses<br>(4 KB → Huge) | Huge Page<br>Memory (KB) |')
+    print('|----|---:|----|---:|---:|---:|---:|')
+    for name in names:
+        normal = rowtime(sizedata[name])[0]
+        misses = sizedata[name][DTLB_MISSES]
+        for mode, runs in sorted(sizehuge[name].items()):
+            time = average([run[0] for run in runs])
+            hugemisses = [run[1] for run in runs if run[1] is not None]
+            if len(misses) > 0 and len(hugemisses) > 0:
+                tlb = '%.0f → %.0f' % (average(misses), average(hugemisses))
+            else:
+                tlb = '-'
+            kb = [run[2] for run in runs if run[2] is not None]
+            print('| [%s][%s] | %.3f | %s | %.3f | %.2fx | %s | %s |' % (sizedata[name][FILE].split('/')[-1],
+                    name, normal, mode, time, normal / time, tlb, len(kb) > 0 and '%i' % max(kb) or '-'))
+    print()
+    print("""
+_Huge page results back the input data, in-situ copies and harness output buffers with 2 MB transparent huge pages (thp) or hugetlbfs pages (hugetlb). With +malloc, glibc also backed the libraries' own allocations with huge pages (GLIBC_TUNABLES=glibc.malloc.hugetlb). dTLB misses are per iteration, and shown only for runs with hardware counters (-c). Huge page memory is the most memory of the process backed by huge pages, since the kernel may not grant them. Times do not have hash subtraction._
+""")
+    print()
+
+def printallocators(sizedata, sizeallocators):
+    names = [name for name in sorted(sizeallocators.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    others = sorted(set(allocator for name in names for allocator in sizeallocators[name]))
+    print("### Allocators")
+    print()
+    p = '| Benchmark | Allocations<br>per Iteration | System<br>(μs) |'
+    for allocator in others:
+        p += ' %s<br>(μs) |' % allocator
+    print(p + ' Sensitivity |')
+    print('|----|---:|---:|' + '---:|' * len(others) + '---:|')
+    for name in names:
+        system = rowtime(sizedata[name])[0]
+        allocations = sizedata[name][ALLOCATIONS]
+        p = '| [%s][%s] | %s | %.3f |' % (sizedata[name][FILE].split('/')[-1], name,
+                len(allocations) > 0 and '%.1f' % average(allocations) or '-', system)
+        times = [system]
+        for allocator in others:
+            if allocator in sizeallocators[name]:
+                time = average(sizeallocators[name][allocator])
+                times.append(time)
+                p += ' %.3f (%.2fx) |' % (time, time / system)
+            else:
+                p += ' - |'
+        print(p + ' %.2fx |' % (max(times) / min(times)))
+    print()
+    print("""
+_Allocator results run each test with another allocator preloaded in place of the system malloc(); the ratio is to the system allocator. Sensitivity is the slowest time over the fastest of all allocators, so libraries that allocate little should be near 1x. Allocations per iteration are with the system allocator. Times do not have hash subtraction._
+""")
+    print()
+
+def printheaps(sizedata, sizeheaps):
+    names = [name for name in sorted(sizeheaps.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    profiles = sorted(set(profile for name in names for profile in sizeheaps[name]))
+    print("### Heap Profiles")
+    print()
+    p = '| Benchmark | Allocations<br>per Iteration | default<br>(μs) |'
+    for profile in profiles:
+        p += ' %s<br>(μs) |' % profile
+    print(p)
+    print('|----|---:|---:|' + '---:|' * len(profiles))
+    for name in names:
+        default = rowtime(sizedata[name])[0]
+        allocations = sizedata[name][ALLOCATIONS]
+        p = '| [%s][%s] | %s | %.3f |' % (sizedata[name][FILE].split('/')[-1], name,
+                len(allocations) > 0 and '%.1f' % average(allocations) or '-', default)
+        for profile in profiles:
+            if profile in sizeheaps[name]:
+                time = average(sizeheaps[name][profile])
+                p += ' %.3f (%.2fx) |' % (time, time / default)
+            else:
+                p += ' - |'
+        print(p)
+    print()
+    print("""
+_Heap profile results pre-fragment the heap differently before the test; the ratio is to the default profile. The pristine profile doesn't fragment at all, churn repeatedly frees and reallocates many small objects, large leaves holes between blocks of 4 to 64 KB, and server also keeps freeing and reallocating blobs between iterations (untimed), as a long-running process would. Times do not have hash subtraction._
+""")
+    print()
+
+# the time and, if the size of the data is known, the throughput
+def workloadstr(time, size):
+    if size > 0:
+        return '%.3f (%.0f MB/s)' % (time, size / time)
+    return '%.3f' % time
+
+def printworkloads(sizedata, sizeworkloads):
+    names = [name for name in sorted(sizeworkloads.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    profiles = sorted(set(profile for name in names for profile in sizeworkloads[name]))
+    print("### Workloads")
+    print()
+    p = '| Benchmark | default<br>(μs) |'
+    for profile in profiles:
+        p += ' %s<br>(μs) |' % profile
+    print(p)
+    print('|----|---:|' + '---:|' * len(profiles))
+    for name in names:
+        row = sizedata[name]
+        p = '| [%s][%s] | %s |' % (row[FILE].split('/')[-1], name,
+                workloadstr(rowtime(row)[0], int(row[DATA_SIZE])))
+        for profile in profiles:
+            if profile in sizeworkloads[name]:
+                runs = sizeworkloads[name][profile]
+                p += ' %s |' % workloadstr(average([run[0] for run in runs]), runs[0][1])
+            else:
+                p += ' - |'
+        print(p)
+    print()
+    print("""
+_Workload results run each test on data generated with another workload profile: telemetry is shallow series of numbers, rest is records of strings and ids with keys from a schema, log is flat maps of messages, config is deeply nested maps of flags and names, records is an array of records sharing the keys of a fixed schema, timeseries is large series of full precision doubles or 64-bit timestamps, chat is long multilingual strings of CJK text, emoji and escapes, and types adds floats, binary, extensions, full range unsigned integers and non-finite reals where the format supports them (base64 strings for binary in JSON and UBJSON). The data differs in size and shape from the default, so times are not comparable across profiles; the throughput in MB/s of encoded data is, roughly. Times do not have hash subtraction._
+""")
+    print()
+
+def printphases(sizedata, sizephases):
+    names = [name for name in sorted(sizephases.keys()) if name in sizedata]
+    if len(names) == 0:
+        return
+    print("### Phases")
+    print()
+    print('| Benchmark | Time<br>(μs) | Parse<br>(μs) | Traverse<br>(μs) | Free<br>(μs) | Other<br>(μs) |')
+    print('|----|---:|---:|---:|---:|---:|')
+    for name in names:
+        runs = sizephases[name]
+        time = average([run[0] for run in runs])
+        p = '| [%s][%s] | %.3f |' % (sizedata[name][FILE].split('/')[-1], name, time)
+        total = 0
+        for i in range(1, len(PHASES) + 1):
+            phase = average([run[i] for run in runs])
+            total += phase
+            p += ' %.3f (%.0f%%) |' % (phase, 100 * phase / time)
+        print(p + ' %.3f |' % (time - total))
+    print()
+    print("""
+_Phase results time the parse, traverse (hash) and free phases of each tree test separately, so a slow library can be told apart by where its time goes: building its tree, walking it, or tearing it down. Other is the rest of the time, mostly in-situ copies of the input. Marking the phases reads the clock four times per iteration, so these times are somewhat higher than in the main tables, especially for small documents. Times do not have hash subtraction._
+""")
+    print()
+
+def printexact(sizedata, sizeexact):
+    if len(sizeexact) == 0:
+        return
+    print("### Exact Values")
+    print()
+    for profile in sorted(sizeexact.keys()):
+        hashes = sizeexact[profile]
+        expected = hashes.get("hash-object")
+        print('| Benchmark (%s) | Hash | Exact |' % profile)
+        print('|----|---:|:---:|')
+        for name in sorted(hashes.keys()):
+            if name in write_tests or name.startswith("hash-"):
+                match = '-'
+            elif expected is None:
+                match = '?'
+            else:
+                match = hashes[name] == expected and '✓' or '✗'
+            print('| %s | %s | %s |' % (name, hashes[name], match))
+        print()
+    print("""
+_Exact value results hash doubles by their exact bits rather than skipping them, and compare the hash of each read test to that of hash-object, which hashes the generated data directly. A ✗ means the test's parser, or the writer of its data file, didn't round-trip some double exactly (a ? means hash-object wasn't run.) Write tests hash their output, so they aren't compared._
+""")
+    print()
+
+def printcounters(sizedata):
+    names = [name for name in sorted(sizedata.keys()) if len(sizedata[name][CYCLES]) > 0]
+    if len(names) == 0:
+        return
+    print("### Hardware Counters")
+    print()
+    print('| Benchmark | Cycles | IPC | Bytes<br>per Cycle | Branch Misses<br>(per KB) | L1D Misses<br>(per KB) | LLC Misses<br>(per KB) | dTLB Misses<br>(per KB) |')
+    print('|----|---:|---:|---:|---:|---:|---:|---:|')
+    for name in names:
+        row = sizedata[name]
+        cycles = average(row[CYCLES])
+        ipc = len(row[INSTRUCTIONS]) > 0 and '%.2f' % (average(row[INSTRUCTIONS]) / cycles) or '-'
+        bytes_per_cycle = int(row[DATA_SIZE]) > 0 and '%.3f' % (int(row[DATA_SIZE]) / cycles) or '-'
+        p = '| [%s][%s] | %.0f | %s | %s |' % (row[FILE].split('/')[-1], name, cycles, ipc, bytes_per_cycle)
+        for column in [BRANCH_MISSES, L1D_MISSES, LLC_MISSES, DTLB_MISSES]:
+            if len(row[column]) > 0 and int(row[DATA_SIZE]) > 0:
+                p += ' %.2f |' % (average(row[column]) * 1024 / int(row[DATA_SIZE]))
+            elif len(row[column]) > 0:
+                p += ' %.0f / iter |' % average(row[column])
+            else:
+                p += ' - |'
+        print(p)
+    print()
+    print("""
+_Counters are measured over the work phase and shown per iteration, without hash subtraction. Bytes per cycle and misses are normalized by the size of the encoded data (the input data file, or the output of Write tests); tests without either (the hash tests) show misses per iteration instead. IPC is instructions per cycle._
+""")
+    print()
+
+def printallocations(sizedata):
+    names = [name for name in sorted(sizedata.keys()) if len(sizedata[name][ALLOCATIONS]) > 0]
+    if len(names) == 0:
+        return
+    print("### Memory Allocation")
+    print()
+    print('| Benchmark | Allocations<br>(per iteration) | Allocated<br>(bytes per iteration) | Peak Heap<br>(bytes) | Memory<br>Amplification |')
+    print('|----|---:|---:|---:|---:|')
+    for name in names:
+        row = sizedata[name]
+        peak = max(row[PEAK_BYTES])
+        p = '| [%s][%s] | %.1f | %.0f | %.0f |' % (row[FILE].split('/')[-1], name,
+                average(row[ALLOCATIONS]), average(row[ALLOCATED_BYTES]), peak)
+        if int(row[DATA_SIZE]) > 0:
+            p += ' %.2fx |' % (peak / int(row[DATA_SIZE]))
+        else:
+            p += ' - |'
+        print(p)
+    print()
+    print("""
+_Allocations are counted over a few extra iterations after the timed loop by replacing malloc() and friends, so they include allocations made by the harness for in-situ copies of the input data. Peak heap is the most bytes live at once during any iteration, relative to the start of that iteration. Memory amplification is the peak heap divided by the size of the encoded data (the input data file, or the output of Write tests)._
+""")
+    print()
+
+def printusage(sizedata):
+    names = [name for name in sorted(sizedata.keys()) if len(sizedata[name][WORK_RSS]) > 0]
+    if len(names) == 0:
+        return
+    print("### Memory Usage")
+    print()
+    print('| Benchmark | Setup RSS<br>(KB) | Peak RSS<br>(KB) | Setup<br>Page Faults | Warm-up<br>Page Faults | Work Page Faults<br>(per iteration) | Major<br>Page Faults |')
+    print('|----|---:|---:|---:|---:|---:|---:|')
+    for name in names:
+        row = sizedata[name]
+        major = average(row[SETUP_MAJOR_FAULTS]) + average(row[WARM_MAJOR_FAULTS]) + \
+                average(row[WORK_MAJOR_FAULTS])
+        print('| [%s][%s] | %.0f | %.0f | %.0f | %.0f | %.3f | %.0f |' % (row[FILE].split('/')[-1], name,
+                max(row[SETUP_RSS]), max(row[WORK_RSS]),
+                average(row[SETUP_MINOR_FAULTS]), average(row[WARM_MINOR_FAULTS]),
+                average(row[WORK_MINOR_FAULTS]), major))
+    print()
+    print("""
+_RSS is the growth of the process's peak resident set size over the baseline taken after the harness fragments memory, after setup and after the work phase respectively. Setup includes loading the input data or generating the object to write. Page faults are minor faults unless noted; work phase faults are per iteration, so they stay near zero for libraries that reuse their memory. Major faults include those of every phase._
+""")
+    print()
+
+def printdrift(sizedata):
+    names = [name for name in sorted(sizedata.keys())
+            if len([d for d in sizedata[name][DRIFT] if abs(d) > DRIFT_TOLERANCE]) > 0]
+    if len(names) == 0:
+        return
+    print("### Clock Drift")
+    print()
+    print('| Benchmark | Runs | Drifted<br>Runs | Largest<br>Drift |')
+    print('|----|---:|---:|---:|')
+    for name in names:
+        row = sizedata[name]
+        drifted = [d for d in row[DRIFT] if abs(d) > DRIFT_TOLERANCE]
+        print('| [%s][%s] | %i | %i | %+.1f%% |' % (row[FILE].split('/')[-1], name,
+                len(row[DRIFT]), len(drifted), 100.0 * max(drifted, key=abs)))
+    print()
+    print("""
+_These tests had runs during which the time of a fixed calibration spin loop changed by more than %.0f%%, meaning the clock speed of the core changed (frequency scaling, turbo or thermal throttling). Their results may be unreliable. Drift is the change in the spin time, so positive drift means the core slowed down._
+""" % (DRIFT_TOLERANCE * 100))
+    print()
+
+def bytesstr(size):
+    for suffix in ["G", "M", "K"]:
+        unit = {"G": 1 << 30, "M": 1 << 20, "K": 1 << 10}[suffix]
+        if size >= unit and size % unit == 0:
+            return '%i %sB' % (size // unit, suffix)
+    return '%i B' % size
+
+# The growth exponent of the time between two sizes: 1 is linear in the
+# size of the data, and above 1 is super-linear.
+def exponent(small, large):
+    (time1, size1), (time2, size2) = small, large
+    if time1 <= 0 or size1 <= 0 or size2 <= size1:
+        return None
+    return log(time2 / time1) / log(size2 / size1)
+
+def printsweep():
+    if len(sweep) == 0:
+        return
+    sizes = sorted(reduce(lambda a, b: a | b, [set(runs.keys()) for runs in sweep.values()]))
+    print("## Size Scaling")
+    print()
+    print('| Benchmark |' + ''.join([' %s |' % bytesstr(size) for size in sizes]) + ' Largest<br>Exponent |')
+    print('|----|' + '---:|' * len(sizes) + '---:|')
+    for name in sorted(sweep.keys()):
+        runs = sweep[name]
+        points = []
+        p = '| %s |' % name
+        for size in sizes:
+            if size not in runs:
+                p += ' - |'
+                continue
+            time = average([run[0] for run in runs[size]])
+            data_size = runs[size][0][1] or size
+            points.append((time, data_size))
+            p += ' %.0f |' % (data_size / time)
+        exponents = [e for e in [exponent(points[i], points[i + 1]) for i in range(len(points) - 1)] if e is not None]
+        if len(exponents) > 0:
+            largest = max(exponents)
+            p += ' %.2f%s |' % (largest, largest > SUPERLINEAR and ' ▲' or '')
+        else:
+            p += ' - |'
+        print(p)
+    print()
+    print("""
+_Each column is a document generated to approximately the given size (in MessagePack; other formats are somewhat bigger), and shows the throughput in MB/s of encoded data without hash subtraction. A library whose throughput falls off at a size has outgrown a level of the cache hierarchy there. The largest exponent is the steepest growth of the time between two consecutive sizes relative to the growth of the data: 1 is linear, and above %.1f (marked ▲) the library is super-linear somewhere in the range._
+""" % SUPERLINEAR)
+    print()
+
+def printenvironment():
+    if len(environments) == 0:
+        return
+    print("## Environment")
+    print()
+    print('| Pinned CPU | Governor | SMT |')
+    print('|----|----|----|')
+    for cpu, governor, smt in sorted(environments):
+        print('| %s | %s | %s |' % (cpu or '-', governor or '-', smt or '-'))
+    print()
+    print("""
+_The CPU the tests were pinned to (with -p), the CPU frequency governor and whether simultaneous multithreading was active while the results were collected. For stable results the governor should be "performance" and the tests should be pinned to a core whose sibling is idle or offline._
+""")
+    print()
+
 def printrows(rows):
     for row in sorted(rows):
         print(row[1])
@@ -259,6 +938,9 @@ for size in range(1,6):
         print("[%s]: %s" % (name, benchmarks_url + row[FILE]))
 print()
 
+if extended:
+    printenvironment()
+
 for size in range(1,6):
     sizedata = data[size]
     if len(sizedata) == 0:
@@ -309,6 +991,9 @@ for size in range(1,6):
         printrows(rows)
         print()
         print(write_footnote)
+        print(throughput_footnote)
+        if show_latency:
+            print(latency_footnote)
         print()
 
     rows = []
@@ -333,6 +1018,9 @@ for size in range(1,6):
         printrows(rows)
         print()
         print(read_footnote)
+        print(throughput_footnote)
+        if show_latency:
+            print(latency_footnote)
         print()
 
     rows = []
@@ -352,5 +1040,27 @@ for size in range(1,6):
         printrows(rows)
         print()
         print(read_footnote)
+        print(throughput_footnote)
+        if show_latency:
+            print(latency_footnote)
         print()
 
+    if extended:
+        printscaling(sizedata, scaling[size])
+        printcold(sizedata, cold[size])
+        printmapped(sizedata, mapped[size])
+        printhuge(sizedata, huge[size])
+        printallocators(sizedata, allocators[size])
+        printheaps(sizedata, heaps[size])
+        printcorpus(sizedata, corpus[size])
+        printworkloads(sizedata, workloads[size])
+        printphases(sizedata, phases[size])
+        printexact(sizedata, exact[size])
+        printcounters(sizedata)
+        printallocations(sizedata)
+        printusage(sizedata)
+        printdrift(sizedata)
+
+if extended:
+    printsweep()
+